@@ -0,0 +1,63 @@
+#include "cell_edits.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+void CellEdits::set(int x, int y, bool alive)
+{
+    if (x < 0 || y < 0 || x >= width || y >= height)
+    {
+        return;
+    }
+    if (edits.empty())
+    {
+        min_x = max_x = x;
+        min_y = max_y = y;
+    }
+    min_x = std::min(min_x, x);
+    max_x = std::max(max_x, x);
+    min_y = std::min(min_y, y);
+    max_y = std::max(max_y, y);
+    edits.push_back({x, y, alive});
+}
+
+void CellEdits::paint(int x0, int y0, int x1, int y1, int radius, bool alive)
+{
+    // one disk per cell of the longest axis
+    int steps = std::max(std::abs(x1 - x0), std::abs(y1 - y0));
+    for (int i = 0; i <= steps; ++i)
+    {
+        int cx = steps == 0 ? x0 : x0 + (x1 - x0) * i / steps;
+        int cy = steps == 0 ? y0 : y0 + (y1 - y0) * i / steps;
+        for (int dy = -radius; dy <= radius; ++dy)
+        {
+            for (int dx = -radius; dx <= radius; ++dx)
+            {
+                if (dx * dx + dy * dy <= radius * radius)
+                {
+                    set(cx + dx, cy + dy, alive);
+                }
+            }
+        }
+    }
+}
+
+void CellEdits::stamp(const Pattern &pattern, int x, int top)
+{
+    for (int py = 0; py < pattern.height; ++py)
+    {
+        for (int px = 0; px < pattern.width; ++px)
+        {
+            set(x + px, top - py, pattern.get(px, py));
+        }
+    }
+}
+
+void CellEdits::rasterize(std::vector<uint8_t> &mask) const
+{
+    mask.assign(size_t(boxWidth()) * boxHeight(), Keep);
+    for (const Edit &edit : edits)
+    {
+        mask[size_t(edit.y - min_y) * boxWidth() + edit.x - min_x] = edit.alive ? Alive : Dead;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "pattern.hpp"
+
+/**
+ * Cells painted, erased or stamped since the last frame, applied to the engine in one go
+ * Edits are kept in order, a later edit of a cell wins. The gpu engines upload the edits of their bounding box as a
+ * single small texture and write them with one scissored draw, the cpu engines set the cells and upload the grid as
+ * they do after a step. Cells outside the grid are dropped
+ **/
+class CellEdits
+{
+public:
+    // values of the edit mask
+    enum : uint8_t
+    {
+        Keep = 0,
+        Dead = 1,
+        Alive = 2,
+    };
+
+    struct Edit
+    {
+        int x, y;
+        bool alive;
+    };
+
+    CellEdits(int width, int height) : width(width), height(height) {}
+
+    void set(int x, int y, bool alive);
+    // disks of the given radius along the segment, a stroke stays continuous whatever the speed of the cursor
+    void paint(int x0, int y0, int x1, int y1, int radius, bool alive);
+    // the whole rectangle of the pattern, its top left cell at (x, top), the grid being drawn with row 0 at the bottom
+    void stamp(const Pattern &pattern, int x, int top);
+
+    bool empty() const { return edits.empty(); }
+    const std::vector<Edit> &list() const { return edits; }
+
+    // bounding box of the edits
+    int left() const { return min_x; }
+    int bottom() const { return min_y; }
+    int boxWidth() const { return max_x - min_x + 1; }
+    int boxHeight() const { return max_y - min_y + 1; }
+
+    /**
+     * Keep, Dead or Alive for every cell of the bounding box, row after row from the bottom row
+     **/
+    void rasterize(std::vector<uint8_t> &mask) const;
+
+    void clear() { edits.clear(); }
+
+private:
+    int width, height;
+    std::vector<Edit> edits;
+    int min_x{0}, min_y{0}, max_x{0}, max_y{0};
+};
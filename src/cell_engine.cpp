@@ -0,0 +1,70 @@
+#include "cell_engine.hpp"
+
+void CellEngine::step(const uint8_t *source, uint8_t *destination, int width, int height, const LifeRule &rule)
+{
+    int radius = rule.radius;
+    int padded_width = width + 2 * radius, padded_height = height + 2 * radius;
+    // one more column and row for the zeros before the first cell
+    int stride = padded_width + 1;
+    summed_area.assign((size_t)stride * (padded_height + 1), 0);
+
+    // the grid is at least as large as the neighbourhood (see LifeRule::fitsGrid), padding only wraps once
+    for (int y = 0; y < padded_height; ++y)
+    {
+        const uint8_t *row = source + (size_t)((y - radius + height) % height) * width;
+        const uint32_t *above = &summed_area[(size_t)y * stride];
+        uint32_t *sums = &summed_area[(size_t)(y + 1) * stride];
+        uint32_t row_sum = 0;
+        for (int x = 0; x < padded_width; ++x)
+        {
+            row_sum += row[(x - radius + width) % width] >= 128;
+            sums[x + 1] = above[x + 1] + row_sum;
+        }
+    }
+
+    // radius 1 rules keep their masks, ranges are only used by Larger than Life rules
+    bool ranges = rule.isLargerThanLife();
+    int side = 2 * radius + 1;
+    for (int y = 0; y < height; ++y)
+    {
+        // cell (x, y) is at (x + radius, y + radius) in the padded grid, its neighbourhood starts at (x, y)
+        const uint32_t *top = &summed_area[(size_t)y * stride];
+        const uint32_t *bottom = &summed_area[(size_t)(y + side) * stride];
+        for (int x = 0; x < width; ++x)
+        {
+            uint8_t texel = source[(size_t)y * width + x];
+            bool self = texel >= 128;
+            int count = int(bottom[x + side] - bottom[x] - top[x + side] + top[x]);
+            if (!rule.include_centre)
+            {
+                count -= self;
+            }
+
+            bool alive;
+            if (ranges)
+            {
+                alive = self ? count >= rule.survival_min && count <= rule.survival_max : count >= rule.birth_min && count <= rule.birth_max;
+            }
+            else
+            {
+                alive = ((self ? rule.survival : rule.birth) >> count) & 1;
+            }
+
+            uint8_t next;
+            if (self)
+            {
+                next = alive ? 255 : uint8_t(rule.states - 2);
+            }
+            else if (texel > 0)
+            {
+                // dying cell
+                next = texel - 1;
+            }
+            else
+            {
+                next = alive ? 255 : 0;
+            }
+            destination[(size_t)y * width + x] = next;
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "rule.hpp"
+
+/**
+ * Cpu engine of the rules the bit-packed kernels can't run: Generations and Larger than Life rules
+ * Cells are stored one byte per cell with the encoding of the state textures: 255 for alive cells, the number of
+ * generations left for dying cells and 0 for dead cells.
+ * Neighbours are counted with a summed-area table of the grid padded by the radius on every side, so each cell
+ * costs 4 reads whatever the radius and the torus needs no special case
+ **/
+class CellEngine
+{
+public:
+    /**
+     * Compute the next generation of source into destination, width * height cells row after row
+     * The grid has to be at least 2 * radius + 1 cells wide and high
+     **/
+    void step(const uint8_t *source, uint8_t *destination, int width, int height, const LifeRule &rule);
+
+private:
+    // inclusive prefix sums of the padded grid, with an extra zero row and column in front
+    std::vector<uint32_t> summed_area;
+};
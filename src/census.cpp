@@ -0,0 +1,369 @@
+#include "census.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    struct KnownObject
+    {
+        const char *name;
+        // rows separated by '/', 'o' for alive cells
+        const char *rows;
+    };
+
+    // named for Life, other rules only name the objects they happen to share with it
+    const KnownObject known_objects[] = {
+        {"block", "oo/oo"},
+        {"blinker", "ooo"},
+        {"beehive", ".oo./o..o/.oo."},
+        {"loaf", ".oo./o..o/.o.o/..o."},
+        {"boat", "oo./o.o/.o."},
+        {"tub", ".o./o.o/.o."},
+        {"ship", "oo./o.o/.oo"},
+        {"pond", ".oo./o..o/o..o/.oo."},
+        {"toad", ".ooo/ooo."},
+        {"beacon", "oo../oo../..oo/..oo"},
+        {"glider", ".o./..o/ooo"},
+    };
+    // longest period among the known objects
+    const long known_period = 4;
+    // objects are stepped on their own with this much free space around them at most
+    const long max_padding = 32;
+
+    /**
+     * Move the coordinates of an object crossing the border of the torus next to each other
+     * The largest empty band of the torus becomes the border
+     **/
+    template <typename Cells, typename Coordinate>
+    void unwrap(Cells &cells, int size, Coordinate coordinate)
+    {
+        std::vector<bool> occupied(size, false);
+        for (auto &cell : cells)
+        {
+            occupied[coordinate(cell)] = true;
+        }
+        int best_start = 0, best_length = 0;
+        for (int start = 0; start < size; ++start)
+        {
+            int length = 0;
+            while (length < size && !occupied[(start + length) % size])
+            {
+                length++;
+            }
+            if (length > best_length)
+            {
+                best_length = length;
+                best_start = start;
+            }
+        }
+        if (best_length == 0)
+        {
+            // spans the whole torus, nothing to do
+            return;
+        }
+        int first = (best_start + best_length) % size;
+        for (auto &cell : cells)
+        {
+            coordinate(cell) = (coordinate(cell) - first + size) % size;
+        }
+    }
+}
+
+ObjectCensus::ObjectCensus(const LifeRule &rule)
+    : rule(rule)
+{
+    for (const KnownObject &object : known_objects)
+    {
+        std::vector<Cell> cells;
+        int x = 0, y = 0;
+        for (const char *c = object.rows; *c != '\0'; ++c)
+        {
+            if (*c == '/')
+            {
+                x = 0;
+                y++;
+                continue;
+            }
+            if (*c == 'o')
+            {
+                cells.push_back({x, y});
+            }
+            x++;
+        }
+        known_names[classify(cells, known_period)] = object.name;
+    }
+}
+
+int ObjectCensus::find(int index)
+{
+    while (parent[index] != index)
+    {
+        // path halving
+        parent[index] = parent[parent[index]];
+        index = parent[index];
+    }
+    return index;
+}
+
+void ObjectCensus::addUniverse(const uint8_t *cells, int size, long period)
+{
+    int count = size * size;
+    parent.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        parent[i] = i;
+    }
+
+    // union every alive cell with the alive cells of the half of its 5x5 neighbourhood already visited
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            if (cells[y * size + x] == 0)
+            {
+                continue;
+            }
+            int index = y * size + x;
+            for (int dy = -2; dy <= 0; ++dy)
+            {
+                for (int dx = -2; dx <= 2; ++dx)
+                {
+                    if (dy == 0 && dx >= 0)
+                    {
+                        break;
+                    }
+                    int neighbour = ((y + dy + size) % size) * size + (x + dx + size) % size;
+                    if (cells[neighbour] == 0)
+                    {
+                        continue;
+                    }
+                    int a = find(index), b = find(neighbour);
+                    if (a != b)
+                    {
+                        parent[std::max(a, b)] = std::min(a, b);
+                    }
+                }
+            }
+        }
+    }
+
+    // gathering the cells of each object
+    int object_total = 0;
+    for (auto &object : objects)
+    {
+        object.clear();
+    }
+    object_of_root.assign(count, -1);
+    for (int index = 0; index < count; ++index)
+    {
+        if (cells[index] == 0)
+        {
+            continue;
+        }
+        int root = find(index);
+        if (object_of_root[root] < 0)
+        {
+            object_of_root[root] = object_total++;
+            if (int(objects.size()) < object_total)
+            {
+                objects.emplace_back();
+            }
+        }
+        objects[object_of_root[root]].push_back({index % size, index / size});
+    }
+
+    for (int i = 0; i < object_total; ++i)
+    {
+        std::vector<Cell> &object = objects[i];
+        unwrap(object, size, [](Cell &cell) -> int & { return cell.x; });
+        unwrap(object, size, [](Cell &cell) -> int & { return cell.y; });
+        addObject(object, period);
+    }
+}
+
+void ObjectCensus::addObject(std::vector<Cell> &cells, long period)
+{
+    std::string code = classify(cells, period);
+    CensusEntry &entry = table[code];
+    if (entry.count == 0)
+    {
+        entry.code = code;
+        auto known = known_names.find(code);
+        if (known != known_names.end())
+        {
+            entry.name = known->second;
+        }
+    }
+    entry.count++;
+    object_count++;
+}
+
+std::string ObjectCensus::canonicalPhase(const std::vector<Cell> &cells) const
+{
+    std::string best;
+    std::vector<Cell> transformed(cells.size());
+    for (int symmetry = 0; symmetry < 8; ++symmetry)
+    {
+        int min_x = 1 << 30, min_y = 1 << 30, max_x = -(1 << 30), max_y = -(1 << 30);
+        for (size_t i = 0; i < cells.size(); ++i)
+        {
+            int x = cells[i].x, y = cells[i].y;
+            if (symmetry & 4)
+            {
+                std::swap(x, y);
+            }
+            if (symmetry & 2)
+            {
+                x = -x;
+            }
+            if (symmetry & 1)
+            {
+                y = -y;
+            }
+            transformed[i] = {x, y};
+            min_x = std::min(min_x, x);
+            min_y = std::min(min_y, y);
+            max_x = std::max(max_x, x);
+            max_y = std::max(max_y, y);
+        }
+
+        // <width>x<height>_ then every row as hexadecimal digits of 4 columns
+        int width = max_x - min_x + 1, height = max_y - min_y + 1;
+        int digits = (width + 3) / 4;
+        std::vector<uint8_t> nibbles(digits * height, 0);
+        for (const Cell &cell : transformed)
+        {
+            int x = cell.x - min_x, y = cell.y - min_y;
+            nibbles[y * digits + x / 4] |= 1 << (x % 4);
+        }
+        std::string encoding = std::to_string(width) + "x" + std::to_string(height) + "_";
+        for (uint8_t nibble : nibbles)
+        {
+            encoding += "0123456789abcdef"[nibble];
+        }
+        if (best.empty() || encoding < best)
+        {
+            best = encoding;
+        }
+    }
+    return best;
+}
+
+std::string ObjectCensus::classify(std::vector<Cell> &cells, long period)
+{
+    if (cells.empty())
+    {
+        return "xs0_0";
+    }
+
+    int min_x = cells[0].x, min_y = cells[0].y, max_x = min_x, max_y = min_y;
+    for (const Cell &cell : cells)
+    {
+        min_x = std::min(min_x, cell.x);
+        min_y = std::min(min_y, cell.y);
+        max_x = std::max(max_x, cell.x);
+        max_y = std::max(max_y, cell.y);
+    }
+    // an object grows by at most one cell per generation on each side
+    int padding = int(std::min(period, max_padding)) + 2;
+    int width = max_x - min_x + 1 + 2 * padding, height = max_y - min_y + 1 + 2 * padding;
+    phase_cells[0].assign(width * height, 0);
+    phase_cells[1].assign(width * height, 0);
+    for (const Cell &cell : cells)
+    {
+        phase_cells[0][(cell.y - min_y + padding) * width + cell.x - min_x + padding] = 1;
+    }
+    // first phase, relative to its bounding box, in scan order
+    std::vector<Cell> first;
+    for (int index = 0; index < width * height; ++index)
+    {
+        if (phase_cells[0][index])
+        {
+            first.push_back({index % width, index / width});
+        }
+    }
+
+    std::string best = canonicalPhase(cells);
+    std::string first_phase = best;
+    std::vector<Cell> phase;
+    for (long generation = 1; generation <= period; ++generation)
+    {
+        // the border stays dead, the padding keeps the object away from it
+        const std::vector<uint8_t> &source = phase_cells[(generation - 1) % 2];
+        std::vector<uint8_t> &destination = phase_cells[generation % 2];
+        phase.clear();
+        for (int y = 1; y < height - 1; ++y)
+        {
+            for (int x = 1; x < width - 1; ++x)
+            {
+                const uint8_t *above = &source[(y - 1) * width + x];
+                const uint8_t *row = &source[y * width + x];
+                const uint8_t *below = &source[(y + 1) * width + x];
+                int neighbours = above[-1] + above[0] + above[1] + row[-1] + row[1] + below[-1] + below[0] + below[1];
+                uint16_t mask = row[0] ? rule.survival : rule.birth;
+                destination[y * width + x] = (mask >> neighbours) & 1;
+                if (destination[y * width + x])
+                {
+                    phase.push_back({x, y});
+                }
+            }
+        }
+        if (phase.empty())
+        {
+            break;
+        }
+
+        // back to the first phase, possibly somewhere else
+        if (phase.size() == first.size())
+        {
+            int dx = phase[0].x - first[0].x, dy = phase[0].y - first[0].y;
+            bool same = true;
+            for (size_t i = 0; i < phase.size() && same; ++i)
+            {
+                same = phase[i].x - first[i].x == dx && phase[i].y - first[i].y == dy;
+            }
+            if (same)
+            {
+                std::string prefix;
+                if (dx != 0 || dy != 0)
+                {
+                    prefix = "xq" + std::to_string(generation);
+                }
+                else if (generation == 1)
+                {
+                    prefix = "xs" + std::to_string(cells.size());
+                }
+                else
+                {
+                    prefix = "xp" + std::to_string(generation);
+                }
+                return prefix + "_" + best;
+            }
+        }
+        best = std::min(best, canonicalPhase(phase));
+    }
+    // died or changed on its own, it was interacting with something else
+    return "zz_" + first_phase;
+}
+
+void ObjectCensus::print(std::ostream &out, int max_lines) const
+{
+    std::vector<const CensusEntry *> entries;
+    for (const auto &item : table)
+    {
+        entries.push_back(&item.second);
+    }
+    std::sort(entries.begin(), entries.end(), [](const CensusEntry *a, const CensusEntry *b)
+              { return a->count > b->count || (a->count == b->count && a->code < b->code); });
+
+    out << "census: " << object_count << " objects of " << entries.size() << " kinds" << std::endl;
+    for (int i = 0; i < int(entries.size()) && i < max_lines; ++i)
+    {
+        out << "  " << entries[i]->count << " " << entries[i]->code;
+        if (!entries[i]->name.empty())
+        {
+            out << " (" << entries[i]->name << ")";
+        }
+        out << std::endl;
+    }
+}
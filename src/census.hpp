@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rule.hpp"
+
+/**
+ * One kind of object, with the number of times it was found
+ * The code follows the usual census naming: xs<cells> for still lifes, xp<period> for oscillators, xq<period> for
+ * spaceships, zz for objects that do not repeat on their own (they were interacting with a neighbour), followed by
+ * the hexadecimal rows of the canonical phase
+ **/
+struct CensusEntry
+{
+    std::string code;
+    std::string name;
+    long count{0};
+};
+
+/**
+ * Classify the objects left by settled soups
+ * Cells closer than 3 cells are labelled as the same object with a union-find pass (so both halves of a beacon stay
+ * together). Each object is stepped on its own to find its period and displacement, and its canonical form is the
+ * smallest encoding over every phase and the 8 rotations and reflections, so the census does not depend on the
+ * orientation or phase an object settled in. Objects are counted in a hash table keyed by their code
+ **/
+class ObjectCensus
+{
+public:
+    explicit ObjectCensus(const LifeRule &rule);
+
+    /**
+     * Count the objects of a settled universe: a size x size torus, one byte per cell, cycling with period
+     **/
+    void addUniverse(const uint8_t *cells, int size, long period);
+
+    long objectCount() const { return object_count; }
+    long kindCount() const { return long(table.size()); }
+
+    /**
+     * Print the most common objects, at most max_lines of them
+     **/
+    void print(std::ostream &out, int max_lines) const;
+
+private:
+    struct Cell
+    {
+        int x, y;
+    };
+
+    int find(int index);
+    void addObject(std::vector<Cell> &cells, long period);
+    // canonical encoding of a single phase over the 8 symmetries
+    std::string canonicalPhase(const std::vector<Cell> &cells) const;
+    // code of an object, its name is looked up among the known objects
+    std::string classify(std::vector<Cell> &cells, long period);
+
+    LifeRule rule;
+    // keyed by the code itself, two kinds never share an entry
+    std::unordered_map<std::string, CensusEntry> table;
+    std::unordered_map<std::string, std::string> known_names;
+    long object_count{0};
+
+    // scratch buffers reused across universes and objects
+    std::vector<int> parent;
+    std::vector<int> object_of_root;
+    std::vector<std::vector<Cell>> objects;
+    std::vector<uint8_t> phase_cells[2];
+};
@@ -0,0 +1,73 @@
+#include "clipboard.hpp"
+
+#include <glad/glad.h> // needed to handle opengl function pointers
+#include <utility>
+
+Clipboard::~Clipboard()
+{
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &clipboard_texture);
+}
+
+void Clipboard::resize(int width, int height)
+{
+    turns = 0;
+    flipped = false;
+    if (width == copied_width && height == copied_height)
+    {
+        return;
+    }
+    copied_width = width;
+    copied_height = height;
+    if (clipboard_texture == 0)
+    {
+        glGenTextures(1, &clipboard_texture);
+        glGenFramebuffers(1, &fbo);
+    }
+    glBindTexture(GL_TEXTURE_2D, clipboard_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, clipboard_texture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Clipboard::upload(const uint8_t *cells)
+{
+    glBindTexture(GL_TEXTURE_2D, clipboard_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, copied_width, copied_height, GL_RED, GL_UNSIGNED_BYTE, cells);
+}
+
+void Clipboard::download(std::vector<uint8_t> &cells) const
+{
+    cells.resize(size_t(copied_width) * copied_height);
+    glBindTexture(GL_TEXTURE_2D, clipboard_texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_UNSIGNED_BYTE, cells.data());
+}
+
+void Clipboard::flip()
+{
+    // mirroring after the turns is mirroring first and turning the other way
+    flipped = !flipped;
+    turns = (4 - turns) % 4;
+}
+
+void Clipboard::sourceCell(int x, int y, int &source_x, int &source_y) const
+{
+    int width = pastedWidth();
+    int height = pastedHeight();
+    // undoing the counterclockwise turns one by one
+    for (int i = 0; i < turns; ++i)
+    {
+        int undone_x = y;
+        y = width - 1 - x;
+        x = undone_x;
+        std::swap(width, height);
+    }
+    source_x = flipped ? width - 1 - x : x;
+    source_y = y;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Rectangle of cells copied from the current generation of an engine, one byte per cell in the encoding of the R8
+ * state textures, pasted elsewhere flipped and rotated
+ * The cells stay on the gpu: the gpu engines copy them from their state texture into the clipboard texture
+ * (glCopyImageSubData, or a framebuffer blit before opengl 4.3), and paste them with a draw that applies the transform
+ * (paste.glsl). The cpu engines, which step on the cpu anyway, upload the cells they copy and read them back to paste
+ **/
+class Clipboard
+{
+public:
+    Clipboard() = default;
+    ~Clipboard();
+
+    Clipboard(const Clipboard &) = delete;
+    Clipboard &operator=(const Clipboard &) = delete;
+
+    bool empty() const { return copied_width == 0; }
+    // size of the copied rectangle
+    int width() const { return copied_width; }
+    int height() const { return copied_height; }
+    // size of the pasted rectangle, once rotated
+    int pastedWidth() const { return turns % 2 == 0 ? copied_width : copied_height; }
+    int pastedHeight() const { return turns % 2 == 0 ? copied_height : copied_width; }
+
+    unsigned int texture() const { return clipboard_texture; }
+    // framebuffer with the texture attached, to blit into it
+    unsigned int framebuffer() const { return fbo; }
+
+    /**
+     * Make room for a copy of width x height cells, the transform is reset
+     **/
+    void resize(int width, int height);
+    // the whole rectangle, one byte per cell row after row
+    void upload(const uint8_t *cells);
+    void download(std::vector<uint8_t> &cells) const;
+
+    // a quarter turn counterclockwise of the pasted cells
+    void rotate() { turns = (turns + 1) % 4; }
+    // mirror of the pasted cells, left to right
+    void flip();
+    // the copied cells are mirrored first, then turned
+    int quarterTurns() const { return turns; }
+    bool isFlipped() const { return flipped; }
+
+    /**
+     * Cell of the copied rectangle pasted at (x, y) of the pasted rectangle, paste.glsl does the same
+     **/
+    void sourceCell(int x, int y, int &source_x, int &source_y) const;
+
+private:
+    int copied_width{0};
+    int copied_height{0};
+    int turns{0};
+    bool flipped{false};
+    unsigned int clipboard_texture{0};
+    unsigned int fbo{0};
+};
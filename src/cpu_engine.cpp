@@ -0,0 +1,305 @@
+#include "cpu_engine.hpp"
+
+#include <bitset>
+#include <utility> // needed for std::index_sequence
+
+BitGrid::BitGrid(int width, int height)
+    : width(width), height(height), words_per_row(width / 64), words((size_t)(width / 64) * height, 0)
+{
+}
+
+void BitGrid::set(int x, int y, bool alive)
+{
+    uint64_t bit = uint64_t(1) << (x % 64);
+    uint64_t &word = row(y)[x / 64];
+    word = alive ? word | bit : word & ~bit;
+}
+
+void BitGrid::fromCells(const uint8_t *cells)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        uint64_t *words_row = row(y);
+        for (int w = 0; w < words_per_row; ++w)
+        {
+            const uint8_t *source = cells + (size_t)y * width + w * 64;
+            uint64_t word = 0;
+            for (int b = 0; b < 64; ++b)
+            {
+                word |= uint64_t(source[b] >= 128) << b;
+            }
+            words_row[w] = word;
+        }
+    }
+}
+
+void BitGrid::toCells(uint8_t *cells, uint8_t alive_value) const
+{
+    for (int y = 0; y < height; ++y)
+    {
+        const uint64_t *words_row = row(y);
+        for (int w = 0; w < words_per_row; ++w)
+        {
+            uint8_t *destination = cells + (size_t)y * width + w * 64;
+            uint64_t word = words_row[w];
+            for (int b = 0; b < 64; ++b)
+            {
+                destination[b] = (word >> b & 1) ? alive_value : 0;
+            }
+        }
+    }
+}
+
+long BitGrid::population() const
+{
+    long count = 0;
+    for (uint64_t word : words)
+    {
+        count += std::bitset<64>(word).count();
+    }
+    return count;
+}
+
+namespace
+{
+    uint64_t splitmix64(uint64_t &state)
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+}
+
+void seedRow(uint64_t *words, int words_per_row, uint64_t seed, long y)
+{
+    uint64_t state = seed ^ (uint64_t(y) * 0xd1342543de82ef95ull);
+    for (int w = 0; w < words_per_row; ++w)
+    {
+        words[w] = splitmix64(state);
+    }
+}
+
+namespace
+{
+    /**
+     * Number of alive neighbours of 64 cells at once, one bit plane per binary digit of the count (bitslicing)
+     **/
+    struct NeighbourCount
+    {
+        uint64_t bit0, bit1, bit2, bit3;
+    };
+
+    inline void fullAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t &sum, uint64_t &carry)
+    {
+        uint64_t partial = a ^ b;
+        sum = partial ^ c;
+        carry = (a & b) | (partial & c);
+    }
+
+    inline uint64_t west(const uint64_t *words, int i, int count)
+    {
+        uint64_t previous = words[i == 0 ? count - 1 : i - 1];
+        return (words[i] << 1) | (previous >> 63);
+    }
+
+    inline uint64_t east(const uint64_t *words, int i, int count)
+    {
+        uint64_t next = words[i == count - 1 ? 0 : i + 1];
+        return (words[i] >> 1) | (next << 63);
+    }
+
+    inline NeighbourCount countNeighbours(const uint64_t *above, const uint64_t *row, const uint64_t *below, int i, int words)
+    {
+        uint64_t above_sum, above_carry, below_sum, below_carry;
+        fullAdd(west(above, i, words), above[i], east(above, i, words), above_sum, above_carry);
+        fullAdd(west(below, i, words), below[i], east(below, i, words), below_sum, below_carry);
+        uint64_t row_west = west(row, i, words), row_east = east(row, i, words);
+        uint64_t row_sum = row_west ^ row_east, row_carry = row_west & row_east;
+
+        // weight 1 digits
+        NeighbourCount count;
+        uint64_t ones_carry;
+        fullAdd(above_sum, row_sum, below_sum, count.bit0, ones_carry);
+
+        // four weight 2 digits
+        uint64_t twos_sum, fours;
+        fullAdd(above_carry, row_carry, below_carry, twos_sum, fours);
+        count.bit1 = twos_sum ^ ones_carry;
+        uint64_t fours_carry = twos_sum & ones_carry;
+        count.bit2 = fours ^ fours_carry;
+        count.bit3 = fours & fours_carry;
+        return count;
+    }
+
+    inline uint64_t countEquals(const NeighbourCount &count, int n)
+    {
+        return (n & 1 ? count.bit0 : ~count.bit0) & (n & 2 ? count.bit1 : ~count.bit1) & (n & 4 ? count.bit2 : ~count.bit2) & (n & 8 ? count.bit3 : ~count.bit3);
+    }
+
+    /**
+     * Cells whose neighbour count is in Mask. Mask is a template parameter so that the whole expression
+     * folds into the few boolean operations that the rule actually needs
+     **/
+    template <uint16_t Mask, size_t... Counts>
+    inline uint64_t matchCounts(const NeighbourCount &count, std::index_sequence<Counts...>)
+    {
+        return ((((Mask >> Counts) & 1) ? countEquals(count, Counts) : uint64_t(0)) | ...);
+    }
+
+    template <uint16_t Birth, uint16_t Survival>
+    void specializedRowKernel(const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *out, int words, const LifeRule &)
+    {
+        for (int i = 0; i < words; ++i)
+        {
+            NeighbourCount count = countNeighbours(above, row, below, i, words);
+            uint64_t born = matchCounts<Birth>(count, std::make_index_sequence<9>{});
+            uint64_t survive = matchCounts<Survival>(count, std::make_index_sequence<9>{});
+            out[i] = (born & ~row[i]) | (survive & row[i]);
+        }
+    }
+
+    void genericRowKernel(const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *out, int words, const LifeRule &rule)
+    {
+        for (int i = 0; i < words; ++i)
+        {
+            NeighbourCount count = countNeighbours(above, row, below, i, words);
+            uint64_t born = 0, survive = 0;
+            for (int n = 0; n <= 8; ++n)
+            {
+                if (rule.birth >> n & 1)
+                {
+                    born |= countEquals(count, n);
+                }
+                if (rule.survival >> n & 1)
+                {
+                    survive |= countEquals(count, n);
+                }
+            }
+            out[i] = (born & ~row[i]) | (survive & row[i]);
+        }
+    }
+
+    template <size_t... Presets>
+    RowKernel presetKernel(const LifeRule &rule, std::index_sequence<Presets...>)
+    {
+        RowKernel kernel = nullptr;
+        ((kernel = (kernel == nullptr && rule == rule_presets[Presets].rule)
+                       ? specializedRowKernel<rule_presets[Presets].rule.birth, rule_presets[Presets].rule.survival>
+                       : kernel),
+         ...);
+        return kernel;
+    }
+}
+
+RowKernel selectRowKernel(const LifeRule &rule)
+{
+    RowKernel kernel = presetKernel(rule, std::make_index_sequence<std::size(rule_presets)>{});
+    return kernel != nullptr ? kernel : genericRowKernel;
+}
+
+bool hasSpecializedKernel(const LifeRule &rule)
+{
+    return selectRowKernel(rule) != genericRowKernel;
+}
+
+void stepGrid(const BitGrid &source, BitGrid &destination, const LifeRule &rule)
+{
+    RowKernel kernel = selectRowKernel(rule);
+    for (int y = 0; y < source.height; ++y)
+    {
+        const uint64_t *above = source.row(y == 0 ? source.height - 1 : y - 1);
+        const uint64_t *below = source.row(y == source.height - 1 ? 0 : y + 1);
+        kernel(above, source.row(y), below, destination.row(y), source.words_per_row, rule);
+    }
+}
+
+LookupTable::LookupTable(const LifeRule &rule)
+    : table_rule(rule), entries(1 << 15, 0)
+{
+    for (int neighbourhood = 0; neighbourhood < (1 << 16); ++neighbourhood)
+    {
+        uint8_t result = 0;
+        for (int y = 1; y <= 2; ++y)
+        {
+            for (int x = 1; x <= 2; ++x)
+            {
+                int neighbours = 0;
+                for (int dy = -1; dy <= 1; ++dy)
+                {
+                    for (int dx = -1; dx <= 1; ++dx)
+                    {
+                        if (dx != 0 || dy != 0)
+                        {
+                            neighbours += neighbourhood >> (4 * (y + dy) + x + dx) & 1;
+                        }
+                    }
+                }
+                bool alive = neighbourhood >> (4 * y + x) & 1;
+                uint16_t mask = alive ? rule.survival : rule.birth;
+                result |= (mask >> neighbours & 1) << (2 * (y - 1) + x - 1);
+            }
+        }
+        entries[neighbourhood >> 1] |= result << ((neighbourhood & 1) * 4);
+    }
+}
+
+namespace
+{
+    /**
+     * Columns x - 1 to x + 2 of a row, for an even x, as the 4 low bits
+     **/
+    inline uint64_t window(const uint64_t *words, int i, int count, int bit)
+    {
+        if (bit == 0)
+        {
+            uint64_t previous = words[i == 0 ? count - 1 : i - 1];
+            return ((words[i] << 1) | (previous >> 63)) & 0xf;
+        }
+        if (bit == 62)
+        {
+            uint64_t next = words[i == count - 1 ? 0 : i + 1];
+            return (words[i] >> 61) | ((next & 1) << 3);
+        }
+        return (words[i] >> (bit - 1)) & 0xf;
+    }
+
+    void lookupRowPair(const uint64_t *rows[4], uint64_t *out_top, uint64_t *out_bottom, int words, const LookupTable &table)
+    {
+        for (int i = 0; i < words; ++i)
+        {
+            uint64_t top = 0, bottom = 0;
+            for (int bit = 0; bit < 64; bit += 2)
+            {
+                uint16_t neighbourhood = uint16_t(window(rows[0], i, words, bit) | window(rows[1], i, words, bit) << 4 |
+                                                  window(rows[2], i, words, bit) << 8 | window(rows[3], i, words, bit) << 12);
+                uint64_t result = table.next(neighbourhood);
+                top |= (result & 3) << bit;
+                bottom |= (result >> 2) << bit;
+            }
+            out_top[i] = top;
+            out_bottom[i] = bottom;
+        }
+    }
+}
+
+void stepGridLookup(const BitGrid &source, BitGrid &destination, const LookupTable &table)
+{
+    int height = source.height;
+    for (int y = 0; y + 1 < height; y += 2)
+    {
+        const uint64_t *rows[4] = {
+            source.row(y == 0 ? height - 1 : y - 1),
+            source.row(y),
+            source.row(y + 1),
+            source.row((y + 2) % height),
+        };
+        lookupRowPair(rows, destination.row(y), destination.row(y + 1), source.words_per_row, table);
+    }
+    if (height % 2 != 0)
+    {
+        // the last row has no partner
+        int y = height - 1;
+        genericRowKernel(source.row((y + height - 1) % height), source.row(y), source.row(0), destination.row(y), source.words_per_row, table.rule());
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "rule.hpp"
+
+/**
+ * Bit-packed grid on a torus, 64 cells per word
+ * Cell (x, y) is bit x % 64 of word x / 64 of row y, so the width has to be a multiple of 64
+ **/
+struct BitGrid
+{
+    int width{0};
+    int height{0};
+    int words_per_row{0};
+    std::vector<uint64_t> words;
+
+    BitGrid() = default;
+    BitGrid(int width, int height);
+
+    uint64_t *row(int y) { return words.data() + (size_t)y * words_per_row; }
+    const uint64_t *row(int y) const { return words.data() + (size_t)y * words_per_row; }
+
+    bool get(int x, int y) const { return row(y)[x / 64] >> (x % 64) & 1; }
+    void set(int x, int y, bool alive);
+
+    /**
+     * Conversion from/to one byte per cell, row after row, as stored in the R8 textures
+     * A cell is alive when the high bit of its byte is set, the low bits may hold its age
+     **/
+    void fromCells(const uint8_t *cells);
+    void toCells(uint8_t *cells, uint8_t alive_value = 255) const;
+
+    long population() const;
+};
+
+/**
+ * Fill a row with random cells, half of them alive, from the seed and the row number only
+ * Runs split in bands (see domain.hpp and out_of_core.hpp) seed the same grid whatever the split
+ **/
+void seedRow(uint64_t *words, int words_per_row, uint64_t seed, long y);
+
+/**
+ * Compute the next state of the 64 * words cells of row, given the rows above and below
+ * Rows wrap horizontally. Specialized kernels ignore the rule argument, it is baked into them
+ **/
+using RowKernel = void (*)(const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *out, int words, const LifeRule &rule);
+
+/**
+ * Return a kernel specialized at compile time if the rule is one of rule_presets, a generic one otherwise
+ **/
+RowKernel selectRowKernel(const LifeRule &rule);
+bool hasSpecializedKernel(const LifeRule &rule);
+
+/**
+ * Compute the next generation of source into destination, both grids must have the same size
+ **/
+void stepGrid(const BitGrid &source, BitGrid &destination, const LifeRule &rule);
+
+/**
+ * Next state of every 4x4 neighbourhood: a 16 bit neighbourhood indexes the next state of its 2x2 centre
+ * Cell (x, y) of the neighbourhood is bit 4 * y + x, bit 2 * y + x of the result is centre cell (x + 1, y + 1).
+ * Two results are packed per byte, so the whole table is 32KB and stays in the L1 cache of most cpus
+ **/
+class LookupTable
+{
+public:
+    explicit LookupTable(const LifeRule &rule);
+
+    uint8_t next(uint16_t neighbourhood) const { return (entries[neighbourhood >> 1] >> ((neighbourhood & 1) * 4)) & 0xf; }
+    const LifeRule &rule() const { return table_rule; }
+
+private:
+    LifeRule table_rule;
+    std::vector<uint8_t> entries;
+};
+
+/**
+ * Same as stepGrid, computing 2x2 cell blocks with one lookup each instead of counting neighbours
+ * Slower than the bitsliced kernels, it is the scalar baseline they are measured against
+ **/
+void stepGridLookup(const BitGrid &source, BitGrid &destination, const LookupTable &table);
@@ -0,0 +1,258 @@
+#include "cpu_life_engine.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream> // needed for std::cout
+
+CpuLifeEngine::CpuLifeEngine(int width, int height, int threads, bool use_lookup_table)
+    : LifeEngine(width, height), threads(threads), use_lookup_table(use_lookup_table), textures(width, height),
+      packed_textures(width, height, 64), upload_ring(size_t(width) * height), cells(size_t(width) * height), next_cells(size_t(width) * height)
+{
+    grids[0] = BitGrid(width, height);
+    grids[1] = BitGrid(width, height);
+}
+
+std::string CpuLifeEngine::name() const
+{
+    if (!rule.isBinary())
+    {
+        return "cpu engine (cell engine)";
+    }
+    if (use_lookup_table)
+    {
+        return "cpu engine (lookup table)";
+    }
+    return hasSpecializedKernel(rule) ? "cpu engine" : "cpu engine (generic kernel)";
+}
+
+void CpuLifeEngine::setRule(const LifeRule &rule, bool track_age)
+{
+    // the cpu kernels never track ages, cells are uploaded as plain alive and dead texels
+    this->rule = rule;
+}
+
+void CpuLifeEngine::load(const uint8_t *cells)
+{
+    std::copy_n(cells, this->cells.size(), this->cells.data());
+    cells_stale = false;
+    grids[0].fromCells(cells);
+    threaded_stepper_loaded = false;
+    // both textures hold the state, nothing looks newborn on the first display
+    uploadGeneration();
+    uploadGeneration();
+    discardHashes();
+}
+
+void CpuLifeEngine::store(uint8_t *cells)
+{
+    if (cells_stale)
+    {
+        grids[0].toCells(cells);
+        return;
+    }
+    std::copy(this->cells.begin(), this->cells.end(), cells);
+}
+
+void CpuLifeEngine::step(int generations)
+{
+    if (!rule.isBinary())
+    {
+        if (cells_stale)
+        {
+            grids[0].toCells(cells.data());
+            cells_stale = false;
+        }
+        // the cells hold the dying states, the grid only follows the alive cells for hashing
+        for (int i = 0; i < generations; ++i)
+        {
+            cell_engine.step(cells.data(), next_cells.data(), width(), height(), rule);
+            std::swap(cells, next_cells);
+        }
+        grids[0].fromCells(cells.data());
+        threaded_stepper_loaded = false;
+    }
+    else
+    {
+        if (use_lookup_table)
+        {
+            if (!lookup_table || !(lookup_table->rule() == rule))
+            {
+                lookup_table = std::make_unique<LookupTable>(rule);
+            }
+            for (int i = 0; i < generations; ++i)
+            {
+                stepGridLookup(grids[0], grids[1], *lookup_table);
+                std::swap(grids[0], grids[1]);
+            }
+            threaded_stepper_loaded = false;
+        }
+        else
+        {
+            if (!threaded_stepper)
+            {
+                threaded_stepper = std::make_unique<ThreadedStepper>(width(), height(), threads);
+                threaded_stepper->report(std::cout);
+            }
+            // the bands stay in the memory of the node stepping them, only the result is copied out
+            if (!threaded_stepper_loaded)
+            {
+                threaded_stepper->load(grids[0]);
+                threaded_stepper_loaded = true;
+            }
+            threaded_stepper->step(generations, rule);
+            threaded_stepper->store(grids[0]);
+        }
+        cells_stale = true;
+    }
+
+    uploadGeneration();
+}
+
+void CpuLifeEngine::edit(const CellEdits &edits)
+{
+    if (edits.empty())
+    {
+        return;
+    }
+    // the grid always follows the alive cells, the cells only when they are up to date
+    for (const CellEdits::Edit &edit : edits.list())
+    {
+        grids[0].set(edit.x, edit.y, edit.alive);
+        if (!cells_stale)
+        {
+            cells[size_t(edit.y) * width() + edit.x] = edit.alive ? 255 : 0;
+        }
+    }
+    threaded_stepper_loaded = false;
+    uploadGeneration();
+}
+
+void CpuLifeEngine::clear(int x, int y, int width, int height)
+{
+    for (int row = y; row < y + height; ++row)
+    {
+        // the bits of the rectangle, a word at a time
+        uint64_t *words = grids[0].row(row);
+        for (int column = x; column < x + width;)
+        {
+            int bit = column % 64;
+            int count = std::min(64 - bit, x + width - column);
+            uint64_t mask = count == 64 ? ~0ull : ((1ull << count) - 1) << bit;
+            words[column / 64] &= ~mask;
+            column += count;
+        }
+        if (!cells_stale)
+        {
+            std::memset(cells.data() + size_t(row) * this->width() + x, 0, width);
+        }
+    }
+    threaded_stepper_loaded = false;
+    uploadGeneration();
+}
+
+void CpuLifeEngine::copy(int x, int y, int width, int height, Clipboard &clipboard)
+{
+    clipboard_cells.resize(size_t(width) * height);
+    for (int row = 0; row < height; ++row)
+    {
+        for (int column = 0; column < width; ++column)
+        {
+            size_t cell = size_t(y + row) * this->width() + x + column;
+            // the dying states of the cell engine are only in the cells
+            clipboard_cells[size_t(row) * width + column] = cells_stale ? (grids[0].get(x + column, y + row) ? 255 : 0) : cells[cell];
+        }
+    }
+    clipboard.resize(width, height);
+    clipboard.upload(clipboard_cells.data());
+}
+
+void CpuLifeEngine::paste(Clipboard &clipboard, int x, int y)
+{
+    if (clipboard.empty())
+    {
+        return;
+    }
+    clipboard.download(clipboard_cells);
+    for (int row = 0; row < clipboard.pastedHeight(); ++row)
+    {
+        for (int column = 0; column < clipboard.pastedWidth(); ++column)
+        {
+            int cell_x = x + column, cell_y = y + row;
+            if (cell_x < 0 || cell_y < 0 || cell_x >= width() || cell_y >= height())
+            {
+                continue;
+            }
+            int source_x, source_y;
+            clipboard.sourceCell(column, row, source_x, source_y);
+            uint8_t value = clipboard_cells[size_t(source_y) * clipboard.width() + source_x];
+            // alive cells have their high bit set, the low bits may hold an age the cpu engines don't track
+            bool alive = value & 0x80;
+            grids[0].set(cell_x, cell_y, alive);
+            if (!cells_stale)
+            {
+                cells[size_t(cell_y) * width() + cell_x] = rule.isBinary() ? (alive ? 255 : 0) : value;
+            }
+        }
+    }
+    threaded_stepper_loaded = false;
+    uploadGeneration();
+}
+
+void CpuLifeEngine::uploadGeneration()
+{
+    bool packed = rule.isBinary();
+    if (packed != packed_display)
+    {
+        // the other textures hold an older generation, both get this one
+        packed_display = packed;
+        uploadGeneration();
+    }
+    StateTextures &target = packed ? packed_textures : textures;
+
+    uint8_t *texels = upload_ring.map();
+    if (texels != nullptr)
+    {
+        if (packed)
+        {
+            std::copy(grids[0].words.begin(), grids[0].words.end(), reinterpret_cast<uint64_t *>(texels));
+        }
+        else
+        {
+            store(texels);
+        }
+        upload_ring.upload(target.destination(), target.texelWidth(), height(), target.format(), target.type());
+    }
+    else if (packed)
+    {
+        // the buffer could not be mapped, going through a copy owned by the driver instead
+        target.upload(target.destination(), grids[0].words.data());
+    }
+    else
+    {
+        if (cells_stale)
+        {
+            grids[0].toCells(cells.data());
+            cells_stale = false;
+        }
+        target.upload(target.destination(), cells.data());
+    }
+    target.swap();
+}
+
+void CpuLifeEngine::submitHash(long generation)
+{
+    // hashed right away, a cpu hash is cheap next to a cpu generation
+    hashes.push_back({generation, hash()});
+}
+
+bool CpuLifeEngine::pollHash(long &generation, StateHash &hash)
+{
+    if (hashes.empty())
+    {
+        return false;
+    }
+    generation = hashes.front().first;
+    hash = hashes.front().second;
+    hashes.pop_front();
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cell_engine.hpp"
+#include "cpu_engine.hpp"
+#include "life_engine.hpp"
+#include "threaded_stepper.hpp"
+#include "upload_ring.hpp"
+
+/**
+ * Engine stepping on the cpu, and uploading every new generation into the state textures for display
+ * New generations are written as texels straight into a persistently mapped buffer (see upload_ring.hpp) that the
+ * gpu copies into the destination texture: no staging copy, and the cpu never waits for the upload. The grids of
+ * binary rules are uploaded as they are, 64 cells per texel, the cells of the other rules one byte per cell.
+ * Binary rules run on the bit-packed grid, either with the bitsliced kernels on every core (see threaded_stepper.hpp)
+ * or with the lookup table. The other rules run one byte per cell on the cell engine. The grid width has to be a
+ * multiple of 64
+ **/
+class CpuLifeEngine : public LifeEngine
+{
+public:
+    // threads = 0 for one worker per cpu
+    CpuLifeEngine(int width, int height, int threads = 0, bool use_lookup_table = false);
+
+    std::string name() const override;
+
+    void setRule(const LifeRule &rule, bool track_age) override;
+    const LifeRule &runningRule() const override { return rule; }
+
+    void load(const uint8_t *cells) override;
+    void store(uint8_t *cells) override;
+    void step(int generations) override;
+    void edit(const CellEdits &edits) override;
+    void clear(int x, int y, int width, int height) override;
+    void copy(int x, int y, int width, int height, Clipboard &clipboard) override;
+    void paste(Clipboard &clipboard, int x, int y) override;
+
+    StateHash hash() override { return hashGrid(grids[0]); }
+    void submitHash(long generation) override;
+    bool pollHash(long &generation, StateHash &hash) override;
+    void discardHashes() override { hashes.clear(); }
+
+    unsigned int currentTexture() const override { return displayed().source(); }
+    unsigned int previousTexture() const override { return displayed().destination(); }
+    int cellsPerTexel() const override { return packed_display ? 64 : 1; }
+
+private:
+    const StateTextures &displayed() const { return packed_display ? packed_textures : textures; }
+    // upload the current generation into the destination texture, which then becomes the current one
+    void uploadGeneration();
+
+    LifeRule rule;
+    int threads;
+    bool use_lookup_table;
+    StateTextures textures;
+    StateTextures packed_textures;
+    // textures holding the last uploaded generation
+    bool packed_display{true};
+    UploadRing upload_ring;
+
+    // current and next generation, current is always up to date with the source texture
+    BitGrid grids[2];
+    // state of the cell engine, only refreshed from the grid when a binary rule stepped since
+    std::vector<uint8_t> cells;
+    bool cells_stale{false};
+    std::unique_ptr<LookupTable> lookup_table;
+    // created on the first generation it steps
+    std::unique_ptr<ThreadedStepper> threaded_stepper;
+    // the stepper keeps its own copy of the grid, reloaded after the other kernels ran
+    bool threaded_stepper_loaded{false};
+    // rules the bitsliced kernels can't run step the cells directly
+    CellEngine cell_engine;
+    std::vector<uint8_t> next_cells;
+
+    std::deque<std::pair<long, StateHash>> hashes;
+    // cells copied or pasted
+    std::vector<uint8_t> clipboard_cells;
+};
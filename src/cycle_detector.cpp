@@ -0,0 +1,104 @@
+#include "cycle_detector.hpp"
+
+#include <string_view>
+
+const char *cycleActionName(CycleAction action)
+{
+    switch (action)
+    {
+    case CycleAction::Report:
+        return "report";
+    case CycleAction::Stop:
+        return "stop";
+    case CycleAction::FastForward:
+        return "fast-forward";
+    }
+    return "";
+}
+
+bool parseCycleAction(const char *name, CycleAction &action)
+{
+    for (CycleAction candidate : {CycleAction::Report, CycleAction::Stop, CycleAction::FastForward})
+    {
+        if (std::string_view(name) == cycleActionName(candidate))
+        {
+            action = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+CycleDetector::CycleDetector(int history_size, int confirmations)
+    : history(history_size), confirmations(confirmations)
+{
+}
+
+bool CycleDetector::add(long generation, const StateHash &hash)
+{
+    if (period_found > 0)
+    {
+        return false;
+    }
+
+    // the most recent earlier generation with the same state gives the shortest period
+    long period = 0;
+    for (const Entry &entry : history)
+    {
+        if (entry.generation >= 0 && entry.generation < generation && entry.hash == hash)
+        {
+            if (period == 0 || generation - entry.generation < period)
+            {
+                period = generation - entry.generation;
+            }
+        }
+    }
+
+    if (period > 0 && period == candidate_period)
+    {
+        candidate_matches++;
+    }
+    else
+    {
+        candidate_period = period;
+        candidate_matches = period > 0 ? 1 : 0;
+        candidate_start = generation - period;
+    }
+
+    // by arrival rather than by generation, the hashed generations may be any stride apart
+    Entry &slot = history[next];
+    next = (next + 1) % history.size();
+    slot.generation = generation;
+    slot.hash = hash;
+
+    if (candidate_matches >= confirmations)
+    {
+        period_found = candidate_period;
+        cycle_start = candidate_start;
+        return true;
+    }
+    return false;
+}
+
+long CycleDetector::generationsToSimulate(long current, long target) const
+{
+    if (period_found <= 0 || target <= current)
+    {
+        return target - current;
+    }
+    return (target - current) % period_found;
+}
+
+void CycleDetector::reset()
+{
+    for (Entry &entry : history)
+    {
+        entry.generation = -1;
+    }
+    next = 0;
+    candidate_period = 0;
+    candidate_matches = 0;
+    candidate_start = 0;
+    period_found = 0;
+    cycle_start = 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+
+#include "state_hash.hpp"
+
+/**
+ * What to do once a run cycles: only report it, stop the run, or skip ahead to the target generation
+ **/
+enum class CycleAction
+{
+    Report,
+    Stop,
+    FastForward
+};
+
+// report, stop or fast-forward
+const char *cycleActionName(CycleAction action);
+// return false if name is not one of the names above
+bool parseCycleAction(const char *name, CycleAction &action);
+
+/**
+ * Detect when a run has settled into a cycle (still lifes have period 1, blinkers period 2...)
+ * The hashes of the last hashed generations are kept in a small ring, in the order they came. A generation whose hash was already seen p generations
+ * earlier is a candidate for period p, it is confirmed once that many successive hashes match with the same p
+ * Only periods spanning fewer hashes than the history size can be detected (a glider crossing a large torus is not)
+ * When only every n-th generation is hashed, the period found is the smallest multiple of n that the period divides,
+ * which is still a period of the run
+ **/
+class CycleDetector
+{
+public:
+    explicit CycleDetector(int history_size = 256, int confirmations = 2);
+
+    /**
+     * Record the hash of a generation, return true when this generation confirms a cycle
+     * Generations are expected in increasing order, at a constant stride to be confirmed
+     **/
+    bool add(long generation, const StateHash &hash);
+
+    bool isCycling() const { return period_found > 0; }
+    long period() const { return period_found; }
+    // first generation known to be part of the cycle
+    long cycleStart() const { return cycle_start; }
+
+    /**
+     * Number of generations left to simulate from current to reach target, knowing the run cycles.
+     * The state at target is the state at current + (target - current) % period
+     **/
+    long generationsToSimulate(long current, long target) const;
+
+    void reset();
+
+private:
+    struct Entry
+    {
+        long generation{-1};
+        StateHash hash;
+    };
+
+    std::vector<Entry> history;
+    // slot of the next hash, the oldest one once the ring is full
+    size_t next{0};
+    int confirmations;
+    long candidate_period{0};
+    int candidate_matches{0};
+    // earlier generation of the first match of the candidate period
+    long candidate_start{0};
+    long period_found{0};
+    long cycle_start{0};
+};
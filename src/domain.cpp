@@ -0,0 +1,360 @@
+#include "domain.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream> // needed for std::cout
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "state_hash.hpp"
+
+namespace
+{
+    /**
+     * Part of the shared segment written by a single process
+     * Aligned on cache lines, so that polling a neighbour does not slow its writes down
+     **/
+    struct alignas(64) RankSlot
+    {
+        // last block whose edge rows are in the halo buffers of this rank
+        std::atomic<long> published{0};
+        StateHash hash;
+        double step_ms{0};
+        double wait_ms{0};
+    };
+
+    struct SharedHeader
+    {
+        // set by the parent when a process failed, the others stop waiting for it
+        std::atomic<bool> aborted{false};
+    };
+    // the slots start on the next cache line
+    const size_t header_size = 64;
+    static_assert(sizeof(SharedHeader) <= header_size);
+
+    /**
+     * Mapping of the shared segment: the header, one slot per rank, then for every rank two generations of edge rows
+     * (even and odd blocks), each made of halo top rows and halo bottom rows
+     **/
+    class SharedSegment
+    {
+    public:
+        SharedSegment(const DomainSettings &settings, int words_per_row)
+            : processes(settings.processes), edge_words(size_t(settings.halo) * words_per_row)
+        {
+            size = header_size + sizeof(RankSlot) * processes + sizeof(uint64_t) * edge_words * 4 * processes;
+            // the name is only needed to create the segment, forked processes inherit the mapping
+            std::string name = "/gameoflife_domain_" + std::to_string(getpid());
+            int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0)
+            {
+                return;
+            }
+            shm_unlink(name.c_str());
+            if (ftruncate(fd, size) == 0)
+            {
+                void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                base = mapping == MAP_FAILED ? nullptr : static_cast<uint8_t *>(mapping);
+            }
+            close(fd);
+            if (base == nullptr)
+            {
+                return;
+            }
+
+            new (base) SharedHeader();
+            for (int rank = 0; rank < processes; ++rank)
+            {
+                new (&slot(rank)) RankSlot();
+            }
+        }
+
+        ~SharedSegment()
+        {
+            if (base != nullptr)
+            {
+                munmap(base, size);
+            }
+        }
+
+        SharedSegment(const SharedSegment &) = delete;
+        SharedSegment &operator=(const SharedSegment &) = delete;
+
+        bool isValid() const { return base != nullptr; }
+
+        SharedHeader &header() { return *reinterpret_cast<SharedHeader *>(base); }
+
+        RankSlot &slot(int rank) { return reinterpret_cast<RankSlot *>(base + header_size)[rank]; }
+
+        // edge 0 is the top rows of the band, edge 1 its bottom rows
+        uint64_t *edge(int rank, long block, int edge)
+        {
+            uint64_t *edges = reinterpret_cast<uint64_t *>(base + header_size + sizeof(RankSlot) * processes);
+            return edges + ((size_t(rank) * 2 + block % 2) * 2 + edge) * edge_words;
+        }
+
+    private:
+        int processes;
+        size_t edge_words;
+        size_t size{0};
+        uint8_t *base{nullptr};
+    };
+
+    /**
+     * Step the band of a single process, the grids hold halo rows above and below the band
+     **/
+    class BandWorker
+    {
+    public:
+        BandWorker(const DomainSettings &settings, const LifeRule &rule, SharedSegment &shared, int rank)
+            : settings(settings), rule(rule), shared(shared), rank(rank), halo(settings.halo),
+              kernel(selectRowKernel(rule))
+        {
+            first_row = int(long(settings.height) * rank / settings.processes);
+            band_rows = int(long(settings.height) * (rank + 1) / settings.processes) - first_row;
+            local_rows = band_rows + 2 * halo;
+            grids[0] = BitGrid(settings.width, local_rows);
+            grids[1] = BitGrid(settings.width, local_rows);
+            up = (rank + settings.processes - 1) % settings.processes;
+            down = (rank + 1) % settings.processes;
+        }
+
+        bool run()
+        {
+            // the halo rows of the first block are seeded here too, no exchange is needed before it
+            for (int row = 0; row < local_rows; ++row)
+            {
+                int y = (first_row - halo + row + settings.height) % settings.height;
+                seedRow(grids[0].row(row), grids[0].words_per_row, settings.seed, y);
+            }
+
+            auto begin = std::chrono::steady_clock::now();
+            double wait_ms = 0;
+            long block = 0;
+            for (long generation = 0; generation < settings.generations;)
+            {
+                block++;
+                int block_generations = int(std::min<long>(halo, settings.generations - generation));
+                bool last_block = generation + block_generations == settings.generations;
+                stepBlock(block, block_generations, !last_block);
+                generation += block_generations;
+                if (last_block)
+                {
+                    break;
+                }
+
+                auto wait_begin = std::chrono::steady_clock::now();
+                if (!receiveHalos(block))
+                {
+                    return false;
+                }
+                wait_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wait_begin).count();
+            }
+
+            RankSlot &slot = shared.slot(rank);
+            slot.step_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() - wait_ms;
+            slot.wait_ms = wait_ms;
+            slot.hash = hashBand();
+            return true;
+        }
+
+    private:
+        void stepRows(int first, int end)
+        {
+            const BitGrid &source = grids[current];
+            BitGrid &destination = grids[1 - current];
+            for (int row = first; row < end; ++row)
+            {
+                kernel(source.row(row - 1), source.row(row), source.row(row + 1), destination.row(row), source.words_per_row, rule);
+            }
+        }
+
+        /**
+         * Step generations generations from the last exchange. Generation t is only valid on local rows t to
+         * local_rows - 1 - t, the band itself is valid after halo generations
+         **/
+        void stepBlock(long block, int generations, bool publish)
+        {
+            for (int t = 1; t <= generations; ++t)
+            {
+                int first = t, end = local_rows - t;
+                if (t < generations || !publish)
+                {
+                    stepRows(first, end);
+                }
+                else
+                {
+                    // edge rows first, so that the neighbours get them while the interior is computed
+                    int top_end = std::min(first + halo, end);
+                    int bottom_first = std::max(end - halo, top_end);
+                    stepRows(first, top_end);
+                    stepRows(bottom_first, end);
+                    publishEdges(block);
+                    stepRows(top_end, bottom_first);
+                }
+                current = 1 - current;
+            }
+        }
+
+        void publishEdges(long block)
+        {
+            const BitGrid &grid = grids[1 - current];
+            size_t edge_words = size_t(halo) * grid.words_per_row;
+            std::memcpy(shared.edge(rank, block, 0), grid.row(halo), edge_words * sizeof(uint64_t));
+            std::memcpy(shared.edge(rank, block, 1), grid.row(band_rows), edge_words * sizeof(uint64_t));
+            shared.slot(rank).published.store(block, std::memory_order_release);
+        }
+
+        bool waitFor(int neighbour, long block)
+        {
+            int spins = 0;
+            while (shared.slot(neighbour).published.load(std::memory_order_acquire) < block)
+            {
+                if (shared.header().aborted.load(std::memory_order_relaxed))
+                {
+                    return false;
+                }
+                if (++spins > 256)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Copy the bottom rows of the band above and the top rows of the band below into the halo rows
+         * The neighbours only overwrite them two blocks later, after having received our own edges of the next block
+         **/
+        bool receiveHalos(long block)
+        {
+            BitGrid &grid = grids[current];
+            size_t edge_words = size_t(halo) * grid.words_per_row;
+            if (!waitFor(up, block) || !waitFor(down, block))
+            {
+                return false;
+            }
+            std::memcpy(grid.row(0), shared.edge(up, block, 1), edge_words * sizeof(uint64_t));
+            std::memcpy(grid.row(halo + band_rows), shared.edge(down, block, 0), edge_words * sizeof(uint64_t));
+            return true;
+        }
+
+        // hash of the band, with the coordinates of the whole torus
+        StateHash hashBand() const
+        {
+            const BitGrid &grid = grids[current];
+            uint32_t low = 0, high = 0;
+            long population = 0;
+            for (int row = 0; row < band_rows; ++row)
+            {
+                const uint64_t *words = grid.row(halo + row);
+                for (int w = 0; w < grid.words_per_row; ++w)
+                {
+                    for (uint64_t word = words[w]; word != 0; word &= word - 1)
+                    {
+                        uint64_t cell = cellHash(w * 64 + __builtin_ctzll(word), first_row + row);
+                        low += uint32_t(cell);
+                        high += uint32_t(cell >> 32);
+                        population++;
+                    }
+                }
+            }
+            return {(uint64_t(high) << 32) | low, population};
+        }
+
+        const DomainSettings &settings;
+        const LifeRule &rule;
+        SharedSegment &shared;
+        int rank;
+        int halo;
+        RowKernel kernel;
+
+        int first_row, band_rows, local_rows;
+        int up, down;
+        BitGrid grids[2];
+        int current{0};
+    };
+}
+
+int runDomainDecomposition(const DomainSettings &settings, const LifeRule &rule)
+{
+    if (!rule.isBinary())
+    {
+        std::cout << "the domain decomposition only runs rules of two states on the 8 neighbours" << std::endl;
+        return -1;
+    }
+    if (settings.width % 64 != 0 || settings.processes < 1 || settings.halo < 1 || settings.height / settings.processes < settings.halo)
+    {
+        std::cout << "the domain decomposition needs a width multiple of 64 and bands of at least halo rows" << std::endl;
+        return -1;
+    }
+
+    SharedSegment shared(settings, settings.width / 64);
+    if (!shared.isValid())
+    {
+        std::cout << "failed to create the shared memory segment" << std::endl;
+        return -1;
+    }
+
+    std::cout << "stepping " << settings.width << "x" << settings.height << " cells of " << ruleToString(rule) << " in "
+              << settings.processes << " processes, exchanging " << settings.halo << " halo rows" << std::endl;
+    auto begin = std::chrono::steady_clock::now();
+
+    std::vector<pid_t> children;
+    for (int rank = 0; rank < settings.processes; ++rank)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            BandWorker worker(settings, rule, shared, rank);
+            // no destructors nor atexit handlers of the parent in the children
+            _exit(worker.run() ? 0 : 1);
+        }
+        if (pid < 0)
+        {
+            std::cout << "failed to start process " << rank << std::endl;
+            shared.header().aborted = true;
+            break;
+        }
+        children.push_back(pid);
+    }
+
+    bool failed = int(children.size()) != settings.processes;
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        int status = 0;
+        pid_t pid = wait(&status);
+        if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            // a missing band blocks its neighbours forever
+            failed = true;
+            shared.header().aborted = true;
+        }
+    }
+    if (failed)
+    {
+        std::cout << "a process failed, no result" << std::endl;
+        return -1;
+    }
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    StateHash hash;
+    for (int rank = 0; rank < settings.processes; ++rank)
+    {
+        RankSlot &slot = shared.slot(rank);
+        hash = combineHashes(hash, slot.hash);
+        std::cout << "  process " << rank << ": " << slot.step_ms << "ms stepping, " << slot.wait_ms << "ms waiting for halos" << std::endl;
+    }
+    std::cout << "generation " << settings.generations << ": population " << hash.population << ", hash " << std::hex << hash.hash << std::dec
+              << " | " << elapsed_ms << "ms, " << settings.generations * 1000.0 / elapsed_ms << " generations/s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+#include "rule.hpp"
+
+struct DomainSettings
+{
+    // the width has to be a multiple of 64, see BitGrid
+    int width{4096};
+    int height{4096};
+    // the torus is split in this many horizontal bands, one process each
+    int processes{4};
+    // rows exchanged with each neighbour, the bands are then stepped halo generations between two exchanges
+    int halo{1};
+    long generations{1000};
+    // every row is seeded from (seed, row), whatever the number of processes
+    uint64_t seed{1};
+};
+
+/**
+ * Step a random torus on the cpu, split in horizontal bands across forked processes, without any window
+ * Each process only allocates its own band and halo rows: bands exchange their edge rows through a POSIX shared
+ * memory segment, halo rows at a time, then step halo generations on their own (the valid part of the band shrinks
+ * by one row per generation on each side). Edge rows are computed first and published before the interior of the
+ * band, so neighbours can go on while the interior is computed.
+ * The hash of the final state does not depend on the number of processes nor on the halo
+ * Return 0 on success
+ **/
+int runDomainDecomposition(const DomainSettings &settings, const LifeRule &rule);
@@ -0,0 +1,168 @@
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+
+namespace
+{
+    // share of the frame period spent stepping, at most and at least
+    const double max_step_budget = 0.75;
+    const double min_step_budget = 0.25;
+    // weight of the last measure in the running averages
+    const double smoothing = 0.25;
+
+    void average(double &mean, double value)
+    {
+        mean = mean > 0.0 ? mean + smoothing * (value - mean) : value;
+    }
+}
+
+const char *swapModeName(SwapMode mode)
+{
+    switch (mode)
+    {
+    case SwapMode::Off:
+        return "off";
+    case SwapMode::On:
+        return "on";
+    case SwapMode::Adaptive:
+        return "adaptive";
+    }
+    return "";
+}
+
+SwapMode nextSwapMode(SwapMode mode)
+{
+    return mode == SwapMode::Off ? SwapMode::On : mode == SwapMode::On ? SwapMode::Adaptive : SwapMode::Off;
+}
+
+bool parseSwapMode(const char *name, SwapMode &mode)
+{
+    for (SwapMode candidate : {SwapMode::Off, SwapMode::On, SwapMode::Adaptive})
+    {
+        if (std::string_view(name) == swapModeName(candidate))
+        {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+FramePacer::FramePacer(int max_generations)
+    : max_generations(max_generations), step_budget(max_step_budget)
+{
+}
+
+void FramePacer::setTargetRate(double frames_per_second)
+{
+    target_rate = frames_per_second;
+    if (target_rate <= 0.0)
+    {
+        generations = 1;
+    }
+    has_last_frame = false;
+}
+
+void FramePacer::setRefreshRate(double frames_per_second)
+{
+    refresh_rate = frames_per_second;
+    has_last_frame = false;
+}
+
+void FramePacer::restart()
+{
+    generations = 1;
+    step_budget = max_step_budget;
+    cpu_ms_per_generation = 0.0;
+    gpu_ms_per_generation = 0.0;
+    has_last_frame = false;
+}
+
+double FramePacer::periodMs() const
+{
+    double period_ms = 0.0;
+    for (double rate : {target_rate, refresh_rate})
+    {
+        if (rate > 0.0)
+        {
+            // a frame can't come sooner than the display shows it
+            period_ms = std::max(period_ms, 1000.0 / rate);
+        }
+    }
+    return period_ms;
+}
+
+void FramePacer::beginStep()
+{
+    step_begin = std::chrono::steady_clock::now();
+    gpu_timing = gpu_timer.begin();
+}
+
+void FramePacer::endStep(int stepped_generations)
+{
+    gpu_timer.end();
+    double cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - step_begin).count();
+    if (gpu_timing)
+    {
+        timed_generations.push_back(stepped_generations);
+    }
+    if (stepped_generations > 0)
+    {
+        average(cpu_ms_per_generation, cpu_ms / stepped_generations);
+        stepped_total += stepped_generations;
+    }
+}
+
+void FramePacer::endFrame()
+{
+    auto now = std::chrono::steady_clock::now();
+    double period_ms = periodMs();
+    bool dropped = false;
+    if (has_last_frame && period_ms > 0.0)
+    {
+        double interval_ms = std::chrono::duration<double, std::milli>(now - last_frame).count();
+        if (interval_ms > 1.5 * period_ms)
+        {
+            // the frame took the place of the frames that could have been shown meanwhile
+            dropped_frames += std::max(1L, std::lround(interval_ms / period_ms) - 1);
+            dropped = true;
+        }
+    }
+    last_frame = now;
+    has_last_frame = true;
+
+    double gpu_ms;
+    while (gpu_timer.poll(gpu_ms))
+    {
+        int timed = timed_generations.front();
+        timed_generations.pop_front();
+        if (timed > 0)
+        {
+            average(gpu_ms_per_generation, gpu_ms / timed);
+        }
+    }
+
+    double generation_ms = std::max(cpu_ms_per_generation, gpu_ms_per_generation);
+    if (target_rate <= 0.0 || generation_ms <= 0.0)
+    {
+        return;
+    }
+    // the rest of the frame is not measured, late frames tell that it needs more of the period
+    step_budget = dropped ? std::max(min_step_budget, 0.85 * step_budget) : std::min(max_step_budget, step_budget + 0.001);
+    int fitting = int(std::clamp(step_budget * period_ms / generation_ms, 1.0, double(max_generations)));
+    if (dropped)
+    {
+        generations = std::max(1, std::min(fitting, generations / 2));
+    }
+    else if (fitting < generations)
+    {
+        generations = fitting;
+    }
+    else if (fitting > generations + generations / 4)
+    {
+        // the estimate comes from smaller batches, it is checked on the way up
+        generations = std::min(fitting, 2 * generations);
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+
+#include "gpu_timer.hpp"
+
+/**
+ * How the swap of the displayed frame waits for the display: never (tearing), at every vertical blank, or at the vertical
+ * blank unless the frame is already late (swap interval -1, when the driver has *_EXT_swap_control_tear)
+ **/
+enum class SwapMode
+{
+    Off,
+    On,
+    Adaptive
+};
+
+const char *swapModeName(SwapMode mode);
+SwapMode nextSwapMode(SwapMode mode);
+// return false if name is not off, on or adaptive
+bool parseSwapMode(const char *name, SwapMode &mode);
+
+/**
+ * Number of generations stepped per frame, so that frames keep coming at a display rate
+ * The cost of a generation is measured on both sides: the cpu time of the step calls, and the gpu time of the commands
+ * they submitted (read back a few frames later, see gpu_timer.hpp). Its running average, the larger of the two, tells
+ * how many generations fit in a share of the frame period, the rest being left to the display pass and the swap. That
+ * share starts at three quarters, shrinks with every dropped frame and slowly grows back while frames are on time.
+ * The count follows the estimate down right away, but only goes up once the estimate is a quarter above it, and at
+ * most doubles per frame: it stays steady while the cost is, which keeps the stride of the hashed generations constant
+ * for the cycle detector. A frame presented more than half a period late counts as dropped, and halves the count.
+ * Without a target rate one generation is stepped per frame, dropped frames are still counted against the refresh rate
+ **/
+class FramePacer
+{
+public:
+    explicit FramePacer(int max_generations = 4096);
+
+    // frames per second to keep, 0 for a single generation per frame
+    void setTargetRate(double frames_per_second);
+    double targetRate() const { return target_rate; }
+    // refresh rate of the display when the swap waits for it, 0 otherwise
+    void setRefreshRate(double frames_per_second);
+
+    int generationsPerFrame() const { return generations; }
+
+    /**
+     * To surround the step and hash calls of a frame
+     **/
+    void beginStep();
+    void endStep(int stepped_generations);
+
+    /**
+     * To be called once per frame, after the swap
+     **/
+    void endFrame();
+
+    /**
+     * Measure again from one generation per frame, after the engine changed. The interval of the next frame, which
+     * includes the switch, is not measured
+     **/
+    void restart();
+
+    long droppedFrames() const { return dropped_frames; }
+    long steppedGenerations() const { return stepped_total; }
+    // period the frames are expected at, 0 when nothing paces them
+    double periodMs() const;
+    // running averages of the cost of a generation, 0 until measured
+    double cpuMsPerGeneration() const { return cpu_ms_per_generation; }
+    double gpuMsPerGeneration() const { return gpu_ms_per_generation; }
+
+private:
+    int max_generations;
+    double target_rate{0.0};
+    double refresh_rate{0.0};
+    int generations{1};
+    double step_budget;
+
+    GpuTimer gpu_timer;
+    bool gpu_timing{false};
+    // generations of every gpu measure in flight
+    std::deque<int> timed_generations;
+    std::chrono::steady_clock::time_point step_begin;
+    double cpu_ms_per_generation{0.0};
+    double gpu_ms_per_generation{0.0};
+
+    std::chrono::steady_clock::time_point last_frame;
+    bool has_last_frame{false};
+    long dropped_frames{0};
+    long stepped_total{0};
+};
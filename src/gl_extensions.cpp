@@ -0,0 +1,101 @@
+#include "gl_extensions.hpp"
+
+#include <cstring>
+
+namespace glext
+{
+    bool program_binary{false};
+    PFNGLGETPROGRAMBINARYPROC_ getProgramBinary{nullptr};
+    PFNGLPROGRAMBINARYPROC_ programBinary{nullptr};
+    PFNGLPROGRAMPARAMETERIPROC_ programParameteri{nullptr};
+
+    bool parallel_shader_compile{false};
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_ maxShaderCompilerThreads{nullptr};
+
+    bool compute_shader{false};
+    PFNGLDISPATCHCOMPUTEPROC_ dispatchCompute{nullptr};
+    PFNGLBINDIMAGETEXTUREPROC_ bindImageTexture{nullptr};
+    PFNGLMEMORYBARRIERPROC_ memoryBarrier{nullptr};
+
+    bool buffer_storage{false};
+    PFNGLBUFFERSTORAGEPROC_ bufferStorage{nullptr};
+
+    bool copy_image{false};
+    PFNGLCOPYIMAGESUBDATAPROC_ copyImageSubData{nullptr};
+
+    bool hasExtension(const char *extension)
+    {
+        int extension_count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+        for (int i = 0; i < extension_count; ++i)
+        {
+            if (std::strcmp(reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i)), extension) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool isSupported(int major, int minor, const char *extension)
+    {
+        int context_major = 0, context_minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &context_major);
+        glGetIntegerv(GL_MINOR_VERSION, &context_minor);
+        if (context_major > major || (context_major == major && context_minor >= minor))
+        {
+            return true;
+        }
+        return extension != nullptr && hasExtension(extension);
+    }
+
+    void load(GLADloadproc loader)
+    {
+        if (isSupported(4, 1, "GL_ARB_get_program_binary"))
+        {
+            getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC_>(loader("glGetProgramBinary"));
+            programBinary = reinterpret_cast<PFNGLPROGRAMBINARYPROC_>(loader("glProgramBinary"));
+            programParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC_>(loader("glProgramParameteri"));
+
+            int format_count = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+            program_binary = getProgramBinary != nullptr && programBinary != nullptr && programParameteri != nullptr && format_count > 0;
+        }
+
+        if (hasExtension("GL_KHR_parallel_shader_compile"))
+        {
+            maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_>(loader("glMaxShaderCompilerThreadsKHR"));
+        }
+        else if (hasExtension("GL_ARB_parallel_shader_compile"))
+        {
+            maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_>(loader("glMaxShaderCompilerThreadsARB"));
+        }
+        if (maxShaderCompilerThreads != nullptr)
+        {
+            // letting the driver pick as many compiler threads as it wants
+            maxShaderCompilerThreads(0xffffffff);
+            parallel_shader_compile = true;
+        }
+
+        // compute shaders are written against glsl 4.30, the extensions alone are not enough
+        if (isSupported(4, 3, nullptr))
+        {
+            dispatchCompute = reinterpret_cast<PFNGLDISPATCHCOMPUTEPROC_>(loader("glDispatchCompute"));
+            bindImageTexture = reinterpret_cast<PFNGLBINDIMAGETEXTUREPROC_>(loader("glBindImageTexture"));
+            memoryBarrier = reinterpret_cast<PFNGLMEMORYBARRIERPROC_>(loader("glMemoryBarrier"));
+            compute_shader = dispatchCompute != nullptr && bindImageTexture != nullptr && memoryBarrier != nullptr;
+        }
+
+        if (isSupported(4, 4, "GL_ARB_buffer_storage"))
+        {
+            bufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC_>(loader("glBufferStorage"));
+            buffer_storage = bufferStorage != nullptr;
+        }
+
+        if (isSupported(4, 3, "GL_ARB_copy_image"))
+        {
+            copyImageSubData = reinterpret_cast<PFNGLCOPYIMAGESUBDATAPROC_>(loader("glCopyImageSubData"));
+            copy_image = copyImageSubData != nullptr;
+        }
+    }
+}
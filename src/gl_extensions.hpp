@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/glad.h> // needed to handle opengl function pointers
+
+/**
+ * The glad loader of this project only covers opengl 3.3 core
+ * Functions from later versions or extensions are loaded here, they stay null when the driver does not expose them,
+ * so every feature relying on them keeps a 3.3 fallback
+ **/
+
+// GL_ARB_get_program_binary (core in 4.1)
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+typedef void(APIENTRYP PFNGLGETPROGRAMBINARYPROC_)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void(APIENTRYP PFNGLPROGRAMBINARYPROC_)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void(APIENTRYP PFNGLPROGRAMPARAMETERIPROC_)(GLuint program, GLenum pname, GLint value);
+
+// GL_KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_)(GLuint count);
+
+// GL_ARB_compute_shader and GL_ARB_shader_image_load_store (core in 4.3 and 4.2)
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_TEXTURE_UPDATE_BARRIER_BIT 0x00000100
+#define GL_FRAMEBUFFER_BARRIER_BIT 0x00000400
+typedef void(APIENTRYP PFNGLDISPATCHCOMPUTEPROC_)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void(APIENTRYP PFNGLBINDIMAGETEXTUREPROC_)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+typedef void(APIENTRYP PFNGLMEMORYBARRIERPROC_)(GLbitfield barriers);
+
+// GL_ARB_buffer_storage (core in 4.4)
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_CLIENT_STORAGE_BIT 0x0200
+typedef void(APIENTRYP PFNGLBUFFERSTORAGEPROC_)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+// GL_ARB_copy_image (core in 4.3)
+typedef void(APIENTRYP PFNGLCOPYIMAGESUBDATAPROC_)(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ,
+                                                   GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ,
+                                                   GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth);
+
+namespace glext
+{
+    // true if the driver can save and restore linked programs
+    extern bool program_binary;
+    extern PFNGLGETPROGRAMBINARYPROC_ getProgramBinary;
+    extern PFNGLPROGRAMBINARYPROC_ programBinary;
+    extern PFNGLPROGRAMPARAMETERIPROC_ programParameteri;
+
+    // true if compile and link statuses can be polled without blocking, the driver then compiles on its own threads
+    extern bool parallel_shader_compile;
+    extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_ maxShaderCompilerThreads;
+
+    // true if compute programs can be built and dispatched, writing textures through image units
+    extern bool compute_shader;
+    extern PFNGLDISPATCHCOMPUTEPROC_ dispatchCompute;
+    extern PFNGLBINDIMAGETEXTUREPROC_ bindImageTexture;
+    extern PFNGLMEMORYBARRIERPROC_ memoryBarrier;
+
+    // true if buffers can stay mapped while the gpu reads them
+    extern bool buffer_storage;
+    extern PFNGLBUFFERSTORAGEPROC_ bufferStorage;
+
+    // true if texels can be copied between textures without going through framebuffers
+    extern bool copy_image;
+    extern PFNGLCOPYIMAGESUBDATAPROC_ copyImageSubData;
+
+    /**
+     * Return true if the driver exposes the given extension
+     **/
+    bool hasExtension(const char *extension);
+
+    /**
+     * Return true if the current context is at least major.minor, or exposes the given extension (unless it is null)
+     **/
+    bool isSupported(int major, int minor, const char *extension);
+
+    /**
+     * Load the optional functions, must be called once the context is current and glad is loaded
+     **/
+    void load(GLADloadproc loader);
+}
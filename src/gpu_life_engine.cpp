@@ -0,0 +1,321 @@
+#include "gpu_life_engine.hpp"
+
+#include <algorithm>
+
+#include "gl_extensions.hpp"
+
+namespace
+{
+    // hashes submitted by hash(), told apart from the generations of submitHash
+    const long blocking_hash_generation = -1;
+    const int compute_group_size = 16;
+}
+
+GpuLifeEngine::GpuLifeEngine(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height)
+    : LifeEngine(width, height), shader_cache(shader_cache), quad_vao(quad_vao), textures(width, height),
+      program(shader_cache), state_hasher(shader_cache, quad_vao, width, height), edit_program(shader_cache),
+      paste_program(shader_cache)
+{
+    edit_program.request(shader_cache.requestProgram("vertex.glsl", "edit.glsl"));
+    paste_program.request(shader_cache.requestProgram("vertex.glsl", "paste.glsl"));
+}
+
+GpuLifeEngine::~GpuLifeEngine()
+{
+    glDeleteTextures(1, &edit_texture);
+}
+
+void GpuLifeEngine::setRule(const LifeRule &rule, bool track_age)
+{
+    requested_rule = rule;
+    this->track_age = track_age;
+    program.request(requestProgram(requested_rule, track_age));
+}
+
+void GpuLifeEngine::reloadShaders()
+{
+    program.request(requestProgram(requested_rule, track_age));
+    edit_program.request(shader_cache.requestProgram("vertex.glsl", "edit.glsl"));
+    paste_program.request(shader_cache.requestProgram("vertex.glsl", "paste.glsl"));
+}
+
+bool GpuLifeEngine::updatePrograms()
+{
+    if (!program.isPending())
+    {
+        return false;
+    }
+    bool swapped = program.update();
+    if (!program.isPending())
+    {
+        if (swapped)
+        {
+            running_rule = requested_rule;
+        }
+        // earlier states were computed with other dynamics, and the tiles that did not change don't tell anything
+        invalidate();
+        return true;
+    }
+    return false;
+}
+
+bool GpuLifeEngine::finishPrograms()
+{
+    if (program.update(true))
+    {
+        running_rule = requested_rule;
+        invalidate();
+    }
+    return program.id() != 0;
+}
+
+void GpuLifeEngine::load(const uint8_t *cells)
+{
+    // both textures hold the state, nothing looks newborn on the first display
+    textures.upload(textures.source(), cells);
+    textures.upload(textures.destination(), cells);
+    invalidate();
+    discardHashes();
+}
+
+void GpuLifeEngine::store(uint8_t *cells)
+{
+    textures.download(cells);
+}
+
+void GpuLifeEngine::step(int generations)
+{
+    if (program.id() == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < generations; ++i)
+    {
+        stepOnce(program.id());
+        textures.swap();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindVertexArray(quad_vao);
+}
+
+void GpuLifeEngine::edit(const CellEdits &edits)
+{
+    // the first edit waits for its program, later ones swap in rebuilt programs, so does paste
+    edit_program.update(edit_program.id() == 0);
+    if (edits.empty() || edit_program.id() == 0)
+    {
+        return;
+    }
+
+    edits.rasterize(edit_mask);
+    glActiveTexture(GL_TEXTURE0);
+    if (edits.boxWidth() > edit_texture_width || edits.boxHeight() > edit_texture_height)
+    {
+        edit_texture_width = std::max(edit_texture_width, edits.boxWidth());
+        edit_texture_height = std::max(edit_texture_height, edits.boxHeight());
+        if (edit_texture == 0)
+        {
+            glGenTextures(1, &edit_texture);
+        }
+        glBindTexture(GL_TEXTURE_2D, edit_texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, edit_texture_width, edit_texture_height, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, NULL);
+    }
+    glBindTexture(GL_TEXTURE_2D, edit_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, edits.boxWidth(), edits.boxHeight(), GL_RED_INTEGER, GL_UNSIGNED_BYTE, edit_mask.data());
+
+    // the cells of the box that are not edited are discarded, the others written into the current generation
+    glBindFramebuffer(GL_FRAMEBUFFER, textures.framebuffer());
+    glDrawBuffer(textures.sourceAttachment());
+    glViewport(0, 0, width(), height());
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(edits.left(), edits.bottom(), edits.boxWidth(), edits.boxHeight());
+    glUseProgram(edit_program.id());
+    glUniform1i(glGetUniformLocation(edit_program.id(), "edits_texture"), 0);
+    glUniform2i(glGetUniformLocation(edit_program.id(), "box_origin"), edits.left(), edits.bottom());
+    glBindVertexArray(quad_vao);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // edited tiles changed without a step
+    invalidate();
+}
+
+void GpuLifeEngine::clear(int x, int y, int width, int height)
+{
+    // dead cells are zero texels, whatever the rule and the display
+    const GLfloat dead[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glBindFramebuffer(GL_FRAMEBUFFER, textures.framebuffer());
+    glDrawBuffer(textures.sourceAttachment());
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x, y, width, height);
+    glClearBufferfv(GL_COLOR, 0, dead);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    invalidate();
+}
+
+void GpuLifeEngine::copy(int x, int y, int width, int height, Clipboard &clipboard)
+{
+    clipboard.resize(width, height);
+    if (glext::copy_image)
+    {
+        glext::copyImageSubData(textures.source(), GL_TEXTURE_2D, 0, x, y, 0, clipboard.texture(), GL_TEXTURE_2D, 0, 0, 0, 0, width, height, 1);
+        return;
+    }
+    // from the attachment of the current generation to the attachment of the clipboard
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, textures.framebuffer());
+    glReadBuffer(textures.sourceAttachment());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, clipboard.framebuffer());
+    glBlitFramebuffer(x, y, x + width, y + height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GpuLifeEngine::paste(Clipboard &clipboard, int x, int y)
+{
+    paste_program.update(paste_program.id() == 0);
+    if (clipboard.empty() || paste_program.id() == 0)
+    {
+        return;
+    }
+
+    // the scissor leaves out the cells past the edges of the grid
+    glBindFramebuffer(GL_FRAMEBUFFER, textures.framebuffer());
+    glDrawBuffer(textures.sourceAttachment());
+    glViewport(0, 0, width(), height());
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x, y, clipboard.pastedWidth(), clipboard.pastedHeight());
+    unsigned int program_id = paste_program.id();
+    glUseProgram(program_id);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, clipboard.texture());
+    glUniform1i(glGetUniformLocation(program_id, "clipboard_texture"), 0);
+    glUniform2i(glGetUniformLocation(program_id, "box_origin"), x, y);
+    glUniform2i(glGetUniformLocation(program_id, "pasted_size"), clipboard.pastedWidth(), clipboard.pastedHeight());
+    glUniform1i(glGetUniformLocation(program_id, "quarter_turns"), clipboard.quarterTurns());
+    glUniform1i(glGetUniformLocation(program_id, "flipped"), clipboard.isFlipped());
+    glBindVertexArray(quad_vao);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    invalidate();
+}
+
+void GpuLifeEngine::makeHashRoom()
+{
+    long generation;
+    StateHash hash;
+    if (state_hasher.inFlight() == state_hasher.capacity() && state_hasher.poll(generation, hash, true))
+    {
+        early_hashes.push_back({generation, hash});
+    }
+}
+
+StateHash GpuLifeEngine::hash()
+{
+    makeHashRoom();
+    state_hasher.submit(textures.source(), blocking_hash_generation);
+    long generation;
+    StateHash hash;
+    while (state_hasher.poll(generation, hash, true))
+    {
+        if (generation == blocking_hash_generation)
+        {
+            break;
+        }
+        early_hashes.push_back({generation, hash});
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return hash;
+}
+
+void GpuLifeEngine::submitHash(long generation)
+{
+    makeHashRoom();
+    state_hasher.submit(textures.source(), generation);
+}
+
+bool GpuLifeEngine::pollHash(long &generation, StateHash &hash)
+{
+    if (!early_hashes.empty())
+    {
+        generation = early_hashes.front().first;
+        hash = early_hashes.front().second;
+        early_hashes.pop_front();
+        return true;
+    }
+    return state_hasher.poll(generation, hash);
+}
+
+void GpuLifeEngine::discardHashes()
+{
+    state_hasher.discardPending();
+    early_hashes.clear();
+}
+
+FragmentLifeEngine::FragmentLifeEngine(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height)
+    : GpuLifeEngine(shader_cache, quad_vao, width, height),
+      tile_stepper(shader_cache, quad_vao, width, height), summed_area(shader_cache, quad_vao, width, height)
+{
+}
+
+uint64_t FragmentLifeEngine::requestProgram(const LifeRule &rule, bool track_age)
+{
+    // fetches of the 8 neighbours, or a summed-area table for larger neighbourhoods
+    const char *step_shader = rule.isLargerThanLife() ? "ltl.glsl" : "fragment.glsl";
+    ShaderDefines defines = programDefines(rule, track_age);
+    ShaderDefines tile_defines = tile_stepper.defines();
+    defines.insert(defines.end(), tile_defines.begin(), tile_defines.end());
+    return shader_cache.requestProgram("tile_vertex.glsl", step_shader, defines);
+}
+
+void FragmentLifeEngine::stepOnce(unsigned int program_id)
+{
+    // Larger than Life programs count their neighbourhoods in the summed-area table of the source texture
+    if (runningRule().isLargerThanLife())
+    {
+        unsigned int summed_area_texture = summed_area.build(textures.source());
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, summed_area_texture);
+        glActiveTexture(GL_TEXTURE0);
+        glUseProgram(program_id);
+        glUniform1i(glGetUniformLocation(program_id, "summed_area"), 2);
+    }
+
+    // selecting the framebuffer not to write on the screen
+    glBindFramebuffer(GL_FRAMEBUFFER, textures.framebuffer());
+    glViewport(0, 0, width(), height());
+    // selecting the colorAttachment of the output texture
+    glDrawBuffer(textures.destinationAttachment());
+    // the output texture is not cleared: tiles that are not stepped keep the state it already holds
+    tile_stepper.step(program_id, textures.source(), textures.destination());
+}
+
+ComputeLifeEngine::ComputeLifeEngine(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height)
+    : GpuLifeEngine(shader_cache, quad_vao, width, height)
+{
+}
+
+uint64_t ComputeLifeEngine::requestProgram(const LifeRule &rule, bool track_age)
+{
+    return shader_cache.requestComputeProgram("compute.glsl", programDefines(rule, track_age));
+}
+
+void ComputeLifeEngine::stepOnce(unsigned int program_id)
+{
+    glUseProgram(program_id);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures.source());
+    glUniform1i(glGetUniformLocation(program_id, "source_texture"), 0);
+    glext::bindImageTexture(0, textures.destination(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+    glUniform1i(glGetUniformLocation(program_id, "destination_image"), 0);
+    glUniform2i(glGetUniformLocation(program_id, "grid_size"), width(), height());
+    glext::dispatchCompute((width() + compute_group_size - 1) / compute_group_size, (height() + compute_group_size - 1) / compute_group_size, 1);
+    // the next generation, the display, the hash and glGetTexImage read what the image stores wrote
+    glext::memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+}
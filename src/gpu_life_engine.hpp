@@ -0,0 +1,114 @@
+#pragma once
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "life_engine.hpp"
+#include "summed_area.hpp"
+#include "tile_stepper.hpp"
+
+/**
+ * Engines stepping the state textures with a shader program
+ * The rule is baked into the program: a new rule requests a new variant, and the previous one keeps stepping until
+ * it is built. Hashes are computed on the gpu and read back asynchronously
+ **/
+class GpuLifeEngine : public LifeEngine
+{
+public:
+    GpuLifeEngine(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height);
+    ~GpuLifeEngine();
+
+    void setRule(const LifeRule &rule, bool track_age) override;
+    const LifeRule &runningRule() const override { return running_rule; }
+    void reloadShaders() override;
+    bool updatePrograms() override;
+    bool finishPrograms() override;
+
+    void load(const uint8_t *cells) override;
+    void store(uint8_t *cells) override;
+    void step(int generations) override;
+    void edit(const CellEdits &edits) override;
+    void clear(int x, int y, int width, int height) override;
+    void copy(int x, int y, int width, int height, Clipboard &clipboard) override;
+    void paste(Clipboard &clipboard, int x, int y) override;
+
+    StateHash hash() override;
+    void submitHash(long generation) override;
+    bool pollHash(long &generation, StateHash &hash) override;
+    void discardHashes() override;
+
+    unsigned int currentTexture() const override { return textures.source(); }
+    unsigned int previousTexture() const override { return textures.destination(); }
+
+protected:
+    virtual uint64_t requestProgram(const LifeRule &rule, bool track_age) = 0;
+    // compute the destination texture from the source texture
+    virtual void stepOnce(unsigned int program_id) = 0;
+    // the destination texture no longer holds the generation before the source, or the program changed
+    virtual void invalidate() {}
+
+    ShaderCache &shader_cache;
+    unsigned int quad_vao;
+    StateTextures textures;
+
+private:
+    // a full ring of the hasher would drop its oldest hash, it is waited for and kept in early_hashes instead
+    void makeHashRoom();
+
+    ProgramSlot program;
+    LifeRule requested_rule;
+    LifeRule running_rule;
+    bool track_age{false};
+
+    GpuStateHasher state_hasher;
+
+    // edits are drawn from a texture holding the mask of their bounding box, it grows with the largest box
+    ProgramSlot edit_program;
+    unsigned int edit_texture{0};
+    int edit_texture_width{0};
+    int edit_texture_height{0};
+    std::vector<uint8_t> edit_mask;
+    ProgramSlot paste_program;
+    // hashes read back while waiting for another one in hash(), returned by the next polls
+    std::deque<std::pair<long, StateHash>> early_hashes;
+};
+
+/**
+ * Game-of-life fragment shaders drawn into the state framebuffer, only on the tiles that can change
+ * Larger than Life rules count their neighbourhoods in a summed-area table built before every generation
+ **/
+class FragmentLifeEngine : public GpuLifeEngine
+{
+public:
+    FragmentLifeEngine(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height);
+
+    std::string name() const override { return "gpu engine"; }
+
+protected:
+    uint64_t requestProgram(const LifeRule &rule, bool track_age) override;
+    void stepOnce(unsigned int program_id) override;
+    void invalidate() override { tile_stepper.invalidate(); }
+
+private:
+    TileStepper tile_stepper;
+    SummedAreaTable summed_area;
+};
+
+/**
+ * Game-of-life compute shader (compute.glsl) writing the destination texture through an image unit
+ * Each work group reads its cells and their neighbours once into shared memory. Needs opengl 4.3, and does not
+ * run Larger than Life rules
+ **/
+class ComputeLifeEngine : public GpuLifeEngine
+{
+public:
+    ComputeLifeEngine(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height);
+
+    std::string name() const override { return "gpu engine (compute)"; }
+    bool supports(const LifeRule &rule) const override { return !rule.isLargerThanLife(); }
+
+protected:
+    uint64_t requestProgram(const LifeRule &rule, bool track_age) override;
+    void stepOnce(unsigned int program_id) override;
+};
@@ -0,0 +1,54 @@
+#include "gpu_timer.hpp"
+
+#include <glad/glad.h> // needed to handle opengl function pointers
+
+GpuTimer::GpuTimer(int query_count)
+    : queries(query_count, 0)
+{
+    glGenQueries(query_count, queries.data());
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(queries.size(), queries.data());
+}
+
+bool GpuTimer::begin()
+{
+    measuring = pending < int(queries.size());
+    if (measuring)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, queries[(oldest + pending) % queries.size()]);
+    }
+    return measuring;
+}
+
+void GpuTimer::end()
+{
+    if (measuring)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        pending++;
+        measuring = false;
+    }
+}
+
+bool GpuTimer::poll(double &elapsed_ms)
+{
+    if (pending == 0)
+    {
+        return false;
+    }
+    GLint available = 0;
+    glGetQueryObjectiv(queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+        return false;
+    }
+    GLuint64 elapsed_ns = 0;
+    glGetQueryObjectui64v(queries[oldest], GL_QUERY_RESULT, &elapsed_ns);
+    elapsed_ms = elapsed_ns / 1e6;
+    oldest = (oldest + 1) % queries.size();
+    pending--;
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * Time the gpu spends on a sequence of commands, read back without stalling
+ * Every measure uses a GL_TIME_ELAPSED query from a small ring, whose result is polled a few frames later once the gpu
+ * is done with it. A measure started while every query is still in flight is skipped rather than waited for.
+ * Queries of a target can't nest: only one timer can measure at a time
+ **/
+class GpuTimer
+{
+public:
+    explicit GpuTimer(int query_count = 4);
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    // return false if no query is free, end must still be called
+    bool begin();
+    void end();
+
+    /**
+     * Read the oldest finished measure, in milliseconds, return false if none is available yet
+     **/
+    bool poll(double &elapsed_ms);
+
+private:
+    std::vector<unsigned int> queries;
+    // measures in flight, the oldest is queries[oldest]
+    int oldest{0};
+    int pending{0};
+    bool measuring{false};
+};
@@ -0,0 +1,64 @@
+#include "hash_log.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+
+bool HashLog::open(const std::string &path)
+{
+    file.open(path);
+    return file.is_open();
+}
+
+bool HashLog::loadReference(const std::string &path)
+{
+    std::ifstream input(path);
+    if (!input)
+    {
+        return false;
+    }
+    std::string line;
+    while (std::getline(input, line))
+    {
+        long generation, population;
+        uint64_t hash;
+        if (line.empty() || line[0] == '#' || std::sscanf(line.c_str(), "%ld %ld %" SCNx64, &generation, &population, &hash) != 3)
+        {
+            continue;
+        }
+        reference[generation] = {hash, population};
+    }
+    return !reference.empty();
+}
+
+void HashLog::note(const std::string &text)
+{
+    if (file.is_open())
+    {
+        file << "# " << text << std::endl;
+    }
+}
+
+bool HashLog::record(long generation, const StateHash &hash)
+{
+    if (file.is_open())
+    {
+        char line[64];
+        std::snprintf(line, sizeof(line), "%ld %ld %016" PRIx64 "\n", generation, hash.population, hash.hash);
+        file << line;
+    }
+    auto expected = reference.find(generation);
+    if (expected == reference.end())
+    {
+        return true;
+    }
+    checked++;
+    if (expected->second == hash)
+    {
+        return true;
+    }
+    if (first_divergence < 0)
+    {
+        first_divergence = generation;
+    }
+    return false;
+}
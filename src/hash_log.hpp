@@ -0,0 +1,45 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#include "state_hash.hpp"
+
+/**
+ * State hash of every generation of a run, written to a file and checked against the log of an earlier run
+ * A line holds a generation, its population and its hash (see StateHash), lines starting with '#' describe the run
+ * and what changed its course (edits, rule changes), and are not compared. The hash only covers alive cells, which is
+ * enough from generation to generation: the dying states of a Generations rule follow from the generations before
+ **/
+class HashLog
+{
+public:
+    // return false if the file could not be created
+    bool open(const std::string &path);
+    // return false if the file could not be read or holds no generation
+    bool loadReference(const std::string &path);
+
+    bool isOpen() const { return file.is_open(); }
+    bool hasReference() const { return !reference.empty(); }
+
+    /**
+     * Write a comment line, flushed so that it is in order with the hashes around it
+     **/
+    void note(const std::string &text);
+
+    /**
+     * Log the hash of a generation, return false if it differs from the one of the reference
+     **/
+    bool record(long generation, const StateHash &hash);
+
+    // first generation that differed from the reference, -1 while none did
+    long firstDivergence() const { return first_divergence; }
+    long checkedGenerations() const { return checked; }
+
+private:
+    std::ofstream file;
+    std::unordered_map<long, StateHash> reference;
+    long first_divergence{-1};
+    long checked{0};
+};
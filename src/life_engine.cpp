@@ -0,0 +1,185 @@
+#include "life_engine.hpp"
+
+#include <iostream> // needed for std::cout
+#include <string_view>
+
+#include "cpu_life_engine.hpp"
+#include "gl_extensions.hpp"
+#include "gpu_life_engine.hpp"
+
+ShaderDefines ruleDefines(const LifeRule &rule)
+{
+    ShaderDefines defines;
+    if (rule.isLargerThanLife())
+    {
+        defines = {{"RADIUS", std::to_string(rule.radius)},
+                   {"BIRTH_MIN", std::to_string(rule.birth_min)},
+                   {"BIRTH_MAX", std::to_string(rule.birth_max)},
+                   {"SURVIVAL_MIN", std::to_string(rule.survival_min)},
+                   {"SURVIVAL_MAX", std::to_string(rule.survival_max)}};
+        if (rule.include_centre)
+        {
+            defines.push_back({"INCLUDE_CENTRE", "1"});
+        }
+    }
+    else
+    {
+        defines = {{"BIRTH_MASK", std::to_string(rule.birth) + "u"}, {"SURVIVAL_MASK", std::to_string(rule.survival) + "u"}};
+    }
+    // ltl.glsl always needs the number of states, fragment.glsl only for Generations rules
+    if (rule.states > 2 || rule.isLargerThanLife())
+    {
+        defines.push_back({"STATES", std::to_string(rule.states)});
+    }
+    return defines;
+}
+
+ShaderDefines ageDefines(bool track_age)
+{
+    return track_age ? ShaderDefines{{"TRACK_AGE", "1"}} : ShaderDefines{};
+}
+
+ShaderDefines programDefines(const LifeRule &rule, bool track_age)
+{
+    ShaderDefines defines = ruleDefines(rule);
+    for (const auto &define : ageDefines(track_age && rule.isBinary()))
+    {
+        defines.push_back(define);
+    }
+    return defines;
+}
+
+StateTextures::StateTextures(int width, int height, int cells_per_texel)
+    : texel_width(width / cells_per_texel), height(height),
+      texel_format(cells_per_texel == 1 ? GL_RED : GL_RG_INTEGER), texel_type(cells_per_texel == 1 ? GL_UNSIGNED_BYTE : GL_UNSIGNED_INT)
+{
+    GLenum internal_format = cells_per_texel == 1 ? GL_R8 : GL_RG32UI;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenTextures(2, textures);
+    for (int i = 0; i < 2; ++i)
+    {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        // allocating only, the state is uploaded by load
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, texel_width, height, 0, texel_format, texel_type, 0);
+        // the texture repeats, so the whole grid is a torus
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, textures[i], 0);
+    }
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "error while checking framebuffer" << status << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+StateTextures::~StateTextures()
+{
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(2, textures);
+}
+
+void StateTextures::upload(unsigned int texture, const void *texels)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texel_width, height, texel_format, texel_type, texels);
+}
+
+void StateTextures::download(void *texels) const
+{
+    glBindTexture(GL_TEXTURE_2D, source());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, texel_format, texel_type, texels);
+}
+
+EngineKind nextEngine(EngineKind kind)
+{
+    switch (kind)
+    {
+    case EngineKind::GpuFragment:
+        return EngineKind::GpuCompute;
+    case EngineKind::GpuCompute:
+        return EngineKind::Cpu;
+    case EngineKind::Cpu:
+        return EngineKind::CpuLookup;
+    case EngineKind::CpuLookup:
+        return EngineKind::GpuFragment;
+    }
+    return EngineKind::GpuFragment;
+}
+
+const char *engineKindName(EngineKind kind)
+{
+    switch (kind)
+    {
+    case EngineKind::GpuFragment:
+        return "fragment";
+    case EngineKind::GpuCompute:
+        return "compute";
+    case EngineKind::Cpu:
+        return "cpu";
+    case EngineKind::CpuLookup:
+        return "lookup";
+    }
+    return "";
+}
+
+bool parseEngineKind(const char *name, EngineKind &kind)
+{
+    for (EngineKind candidate : {EngineKind::GpuFragment, EngineKind::GpuCompute, EngineKind::Cpu, EngineKind::CpuLookup})
+    {
+        if (std::string_view(name) == engineKindName(candidate))
+        {
+            kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<LifeEngine> makeEngine(EngineKind kind, ShaderCache &shader_cache, unsigned int quad_vao, int width, int height,
+                                       const LifeRule &rule, bool track_age, int cpu_threads)
+{
+    if (!rule.fitsGrid(width, height))
+    {
+        std::cout << "the neighbourhood of " << ruleToString(rule) << " is larger than the " << width << "x" << height << " grid" << std::endl;
+        return nullptr;
+    }
+    std::unique_ptr<LifeEngine> engine;
+    switch (kind)
+    {
+    case EngineKind::GpuFragment:
+        engine = std::make_unique<FragmentLifeEngine>(shader_cache, quad_vao, width, height);
+        break;
+    case EngineKind::GpuCompute:
+        if (!glext::compute_shader)
+        {
+            std::cout << "the compute engine needs opengl 4.3" << std::endl;
+            return nullptr;
+        }
+        engine = std::make_unique<ComputeLifeEngine>(shader_cache, quad_vao, width, height);
+        break;
+    case EngineKind::Cpu:
+    case EngineKind::CpuLookup:
+        if (width % 64 != 0)
+        {
+            std::cout << "the cpu engine needs a grid width multiple of 64" << std::endl;
+            return nullptr;
+        }
+        engine = std::make_unique<CpuLifeEngine>(width, height, cpu_threads, kind == EngineKind::CpuLookup);
+        break;
+    }
+    if (!engine->supports(rule))
+    {
+        std::cout << "the " << engine->name() << " can't run " << ruleToString(rule) << std::endl;
+        return nullptr;
+    }
+    engine->setRule(rule, track_age);
+    return engine;
+}
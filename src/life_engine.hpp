@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h> // needed to handle opengl function pointers
+#include <memory>
+#include <string>
+
+#include "cell_edits.hpp"
+#include "clipboard.hpp"
+#include "rule.hpp"
+#include "shader.hpp"
+#include "state_hash.hpp"
+
+/**
+ * Defines baking the rule into the game-of-life shader variants
+ **/
+ShaderDefines ruleDefines(const LifeRule &rule);
+
+/**
+ * Defines of the game-of-life and display variants storing the age of each cell in its texel
+ **/
+ShaderDefines ageDefines(bool track_age);
+
+/**
+ * Only the binary rules track ages, the low bits of the texels count the dying generations of the others
+ **/
+ShaderDefines programDefines(const LifeRule &rule, bool track_age);
+
+/**
+ * Two textures holding the current and the previous generation, both attached to a framebuffer so that either can be
+ * drawn into. With one cell per texel they are R8 textures in the encoding of fragment.glsl, with 64 they are RG32UI
+ * textures holding the words of a BitGrid: cell x of a row is bit x % 64 of texel x / 64, bits 32 to 63 in green
+ **/
+class StateTextures
+{
+public:
+    StateTextures(int width, int height, int cells_per_texel = 1);
+    ~StateTextures();
+
+    StateTextures(const StateTextures &) = delete;
+    StateTextures &operator=(const StateTextures &) = delete;
+
+    // current generation
+    unsigned int source() const { return textures[current]; }
+    // previous generation, overwritten by the next one
+    unsigned int destination() const { return textures[1 - current]; }
+    unsigned int framebuffer() const { return fbo; }
+    GLenum sourceAttachment() const { return GL_COLOR_ATTACHMENT0 + current; }
+    GLenum destinationAttachment() const { return GL_COLOR_ATTACHMENT0 + 1 - current; }
+
+    // the destination becomes the current generation
+    void swap() { current = 1 - current; }
+
+    // whole textures, in the format of the texels
+    void upload(unsigned int texture, const void *texels);
+    void download(void *texels) const;
+
+    int texelWidth() const { return texel_width; }
+    GLenum format() const { return texel_format; }
+    GLenum type() const { return texel_type; }
+
+private:
+    int texel_width, height;
+    GLenum texel_format, texel_type;
+    unsigned int textures[2]{0, 0};
+    unsigned int fbo{0};
+    int current{0};
+};
+
+/**
+ * Backend computing the generations of a grid on a torus
+ * Every engine exposes its current and previous generations as textures, which is all the renderer needs, and
+ * converts its state from and to one byte per cell in the encoding of the textures, so that an engine can continue
+ * the run of another one: engines are swapped at runtime with store and load
+ **/
+class LifeEngine
+{
+public:
+    LifeEngine(int width, int height) : grid_width(width), grid_height(height) {}
+    virtual ~LifeEngine() = default;
+
+    LifeEngine(const LifeEngine &) = delete;
+    LifeEngine &operator=(const LifeEngine &) = delete;
+
+    virtual std::string name() const = 0;
+    int width() const { return grid_width; }
+    int height() const { return grid_height; }
+
+    virtual bool supports(const LifeRule &rule) const { return true; }
+
+    /**
+     * Select the rule, and whether binary rules track the age of the cells in their texels
+     * Gpu engines keep stepping with the previous program until the new one is built, see runningRule
+     **/
+    virtual void setRule(const LifeRule &rule, bool track_age) = 0;
+    // rule of the generations stepped now
+    virtual const LifeRule &runningRule() const = 0;
+
+    // rebuild the programs from their edited sources
+    virtual void reloadShaders() {}
+    // swap in the programs built since the last call, return true if the stepped dynamics changed
+    virtual bool updatePrograms() { return false; }
+    // wait for the requested programs, return false if there is still nothing to step with
+    virtual bool finishPrograms() { return true; }
+
+    /**
+     * Replace or read the current generation, one byte per cell row after row
+     **/
+    virtual void load(const uint8_t *cells) = 0;
+    virtual void store(uint8_t *cells) = 0;
+
+    virtual void step(int generations) = 0;
+
+    /**
+     * Paint, erase and stamp cells of the current generation, the previous one is left as it was
+     **/
+    virtual void edit(const CellEdits &edits) = 0;
+    /**
+     * Kill every cell of a rectangle of the current generation at once, the rectangle has to be inside the grid
+     **/
+    virtual void clear(int x, int y, int width, int height) = 0;
+
+    /**
+     * Copy a rectangle of the current generation into the clipboard, the rectangle has to be inside the grid
+     **/
+    virtual void copy(int x, int y, int width, int height, Clipboard &clipboard) = 0;
+    /**
+     * Paste the clipboard, flipped and rotated, with its bottom left cell at (x, y). Cells out of the grid are left out
+     **/
+    virtual void paste(Clipboard &clipboard, int x, int y) = 0;
+
+    /**
+     * Hash of the current generation, waits for it
+     **/
+    virtual StateHash hash() = 0;
+    long population() { return hash().population; }
+
+    /**
+     * Queue the hash of the current generation, labelled with its generation number, without waiting for it
+     * pollHash returns the completed ones in order, gpu engines only a couple of frames later. Every submitted hash is
+     * returned: when too many are in flight, submitting waits for the oldest one
+     **/
+    virtual void submitHash(long generation) = 0;
+    virtual bool pollHash(long &generation, StateHash &hash) = 0;
+    virtual void discardHashes() = 0;
+
+    // textures of the current and previous generations, for display
+    // the cpu engines only upload the last generation of a step, their previous one is the one before the step
+    virtual unsigned int currentTexture() const = 0;
+    virtual unsigned int previousTexture() const = 0;
+    // 1 for R8 textures, 64 for bit-packed ones (see StateTextures)
+    virtual int cellsPerTexel() const { return 1; }
+
+private:
+    int grid_width, grid_height;
+};
+
+/**
+ * Engines, in the order the C key cycles through them
+ **/
+enum class EngineKind
+{
+    GpuFragment,
+    GpuCompute,
+    Cpu,
+    CpuLookup,
+};
+
+EngineKind nextEngine(EngineKind kind);
+// fragment, compute, cpu or lookup
+const char *engineKindName(EngineKind kind);
+// return false if name is not one of the names above
+bool parseEngineKind(const char *name, EngineKind &kind);
+
+/**
+ * Create an engine with the given grid size and rule, or print why it is not available and return null
+ * cpu_threads is the number of workers of the cpu engine, 0 for every cpu
+ **/
+std::unique_ptr<LifeEngine> makeEngine(EngineKind kind, ShaderCache &shader_cache, unsigned int quad_vao, int width, int height,
+                                       const LifeRule &rule, bool track_age, int cpu_threads = 0);
@@ -1,14 +1,46 @@
 #include <glad/glad.h>  // needed to handle opengl function pointers
 #include <GLFW/glfw3.h> // needed for windowing management
-#include <fstream>      // needed to read shaders from file
 #include <iostream>     // needed for std::cout
-#include <sstream>      // needed to simply get strings from files
-#include <cmath>        //! TODO needed ?
-#include <random>       // needed to have random number for grid initialisation
-#include <string_view>
+#include <algorithm>    // needed to bound the generations of a frame
+#include <chrono>       // needed to measure startup time
+#include <cmath>        // needed to map the cursor to cells
+#include <fstream>      // needed to read the memory use of the process
+#include <iomanip>      // needed to format the overlay
+#include <sstream>      // needed to format the overlay
+#include <unistd.h>     // needed to convert memory pages to bytes
+#include <future>       // needed to generate the seed while shaders compile
+#include <random>       // needed to draw a seed when none is given
+#include <string>
+#include <memory>
+#include <vector>
+
+#include "cell_edits.hpp"      // needed to paint cells with the mouse
+#include "clipboard.hpp"       // needed to copy and paste rectangles of cells
+#include "cycle_detector.hpp"  // needed to stop runs that settled
+#include "domain.hpp"          // needed to split large grids across processes
+#include "frame_pacer.hpp"     // needed to step as many generations as a frame has time for
+#include "hash_log.hpp"        // needed to log and check the hash of every generation
+#include "gpu_timer.hpp"       // needed to time the display pass
+#include "gl_extensions.hpp" // needed to use opengl functions newer than glad
+#include "life_engine.hpp"   // needed to step the simulation on any backend
+#include "out_of_core.hpp"   // needed to step grids larger than the memory
+#include "pattern.hpp"       // needed to stamp patterns
+#include "recorder.hpp"      // needed to export the display pass
+#include "renderer.hpp"      // needed to display the state of the engine
+#include "rule.hpp"          // needed to select the simulated rule
+#include "scenario.hpp"      // needed to read the options and write snapshots
+#include "shader.hpp"        // needed to build shader variants
+#include "shader_watcher.hpp" // needed to reload edited shaders
+#include "sparse_world.hpp"   // needed to step unbounded worlds
+#include "soup_search.hpp"    // needed to run batches of small soups
+#include "threaded_stepper.hpp" // needed to report the placement of the cpu workers
+#include "state_hash.hpp"     // needed to detect cycles from state hashes
+#include "text_overlay.hpp"   // needed to show performance counters over the display
 
 //
 void framebufferSizeCallback(GLFWwindow *window, int width, int height);
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
+void scrollCallback(GLFWwindow *window, double x_offset, double y_offset);
 void processInput(GLFWwindow *window);
 
 // namespace related to screen positioning
@@ -36,10 +68,14 @@ namespace fps
     int num_frame{0};
     float last_frame_time{0.0f};
 
+    // counters of the pacer at the last display
+    long last_generations{0};
+    long last_dropped_frames{0};
+
     /**
-     * Update the current time and display fps and spf
+     * Update the current time and display fps and spf, with the generations and the dropped frames of the period
      * */
-    void countFPS()
+    void countFPS(const FramePacer &pacer)
     {
         double current_time = glfwGetTime();
         num_frame++;
@@ -48,153 +84,623 @@ namespace fps
         // we don't want to print the fps all the time. We sample the number of frames during one second
         if (interval >= time_between_fps_display)
         {
-            std::cout << "fps " << num_frame << " | " << 1000.0 * interval / num_frame << "ms / frame\n";
+            std::cout << "fps " << num_frame << " | " << 1000.0 * interval / num_frame << "ms / frame | "
+                      << (pacer.steppedGenerations() - last_generations) / interval << " generations/s";
+            if (pacer.periodMs() > 0.0)
+            {
+                std::cout << " | " << pacer.droppedFrames() - last_dropped_frames << " dropped";
+            }
+            std::cout << "\n";
             num_frame = 0;
             last_frame_time = current_time;
+            last_generations = pacer.steppedGenerations();
+            last_dropped_frames = pacer.droppedFrames();
         }
     }
 
 }
-/**
- * Return the content of a shader file as a string, exit if no shader file found
- **/
-std::string tryGetShaderContent(const char *path)
+
+// namespace related to the swap interval and to the number of generations stepped per frame
+// the V key cycles through the swap modes, the P key toggles pacing
+// NB: see namespace fps for design-decision explanation
+namespace pacing
 {
+    SwapMode swap_mode{SwapMode::On};
+    bool swap_mode_changed{true};
+    // --target-fps <rate> paces the run from the start, at the refresh rate of the display if 0
+    bool enabled{false};
+    double target_rate{0.0};
+    bool settings_changed{true};
 
-    std::ifstream shaderFile(path);
-    if (!shaderFile.is_open())
+    /**
+     * Refresh rate of the monitor showing the window, 60 if unknown
+     * */
+    double refreshRate()
     {
-        std::cout << "could not open shader at " << path << std::endl;
-        std::exit(1);
+        GLFWmonitor *monitor = glfwGetPrimaryMonitor();
+        const GLFWvidmode *mode = monitor != NULL ? glfwGetVideoMode(monitor) : NULL;
+        return mode != NULL && mode->refreshRate > 0 ? mode->refreshRate : 60.0;
     }
-    std::stringstream shaderStrStream;
-    shaderStrStream << shaderFile.rdbuf();
-    shaderFile.close();
 
-    std::string shaderFileString = shaderStrStream.str();
-    return shaderFileString;
+    /**
+     * Set the swap interval of the current context and hand the new settings to the pacer
+     * */
+    void apply(FramePacer &pacer)
+    {
+        if (swap_mode_changed)
+        {
+            swap_mode_changed = false;
+            int interval = swap_mode == SwapMode::Off ? 0 : 1;
+            if (swap_mode == SwapMode::Adaptive)
+            {
+                if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+                {
+                    // late frames are swapped right away instead of waiting for the next vertical blank
+                    interval = -1;
+                }
+                else
+                {
+                    std::cout << "adaptive vsync is not supported by the driver, ";
+                }
+            }
+            glfwSwapInterval(interval);
+            std::cout << "vsync " << (interval < 0 ? "adaptive" : interval == 0 ? "off" : "on") << std::endl;
+            pacer.setRefreshRate(interval == 0 ? 0.0 : refreshRate());
+        }
+        if (settings_changed)
+        {
+            settings_changed = false;
+            double rate = !enabled ? 0.0 : target_rate > 0.0 ? target_rate : refreshRate();
+            pacer.setTargetRate(rate);
+            if (enabled)
+            {
+                std::cout << "pacing the run at " << rate << " frames/s" << std::endl;
+            }
+        }
+    }
 }
 
-int main()
+// namespace related to the performance counters drawn over the display, toggled with the O key or --overlay
+// NB: see namespace fps for design-decision explanation
+namespace overlay
 {
+    bool enabled{false};
+    // the counters start over when the overlay is shown, those of the hidden period would be stale
+    bool restart{true};
+    // the text is only rebuilt a few times per second, drawing it is a single quad
+    const double time_between_updates = 0.5;
+    double last_update_time{0.0};
+    int num_frame{0};
+    long last_generations{0};
+    // population of the last hashed generation
+    long population{0};
+    // gpu time of the display pass
+    double display_ms{0.0};
 
-    std::random_device rd;
-    // mersen twister random number generator
-    std::mt19937 mt(rd());
-    // we want to generatre random number as 0 or 1, (2 cell states)
-    std::uniform_int_distribution<> dist(0, 1);
+    /**
+     * Resident memory of the process, in MB
+     * */
+    double residentMemoryMb()
+    {
+        std::ifstream statm("/proc/self/statm");
+        long total_pages = 0, resident_pages = 0;
+        statm >> total_pages >> resident_pages;
+        return resident_pages * double(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+    }
 
-    // Initialize and configure glfw
-    // ------------------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    /**
+     * Video memory left, in MB, or -1 when the driver does not tell
+     * */
+    double freeVideoMemoryMb()
+    {
+        if (glfwExtensionSupported("GL_NVX_gpu_memory_info"))
+        {
+            GLint free_kb = 0;
+            glGetIntegerv(0x9049, &free_kb); // GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+            return free_kb / 1024.0;
+        }
+        if (glfwExtensionSupported("GL_ATI_meminfo"))
+        {
+            GLint free_kb[4] = {0, 0, 0, 0};
+            glGetIntegerv(0x87FC, free_kb); // GL_TEXTURE_FREE_MEMORY_ATI
+            return free_kb[0] / 1024.0;
+        }
+        return -1.0;
+    }
 
-    // create glfw window
-    // ------------------------------------------
-    GLFWwindow *window = glfwCreateWindow(screen::width, screen::height, "Game of no life", NULL, NULL);
-    if (window == NULL)
+    /**
+     * Rebuild the text of the overlay from the counters of the last period
+     * */
+    void update(TextOverlay &text, const LifeEngine &engine, const FramePacer &pacer, long generation)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        double current_time = glfwGetTime();
+        if (restart)
+        {
+            restart = false;
+            num_frame = 0;
+            last_update_time = current_time;
+            last_generations = pacer.steppedGenerations();
+            return;
+        }
+        num_frame++;
+        double interval{current_time - last_update_time};
+        if (interval < time_between_updates)
+        {
+            return;
+        }
+        double generations_per_second = (pacer.steppedGenerations() - last_generations) / interval;
+
+        std::vector<std::string> lines;
+        std::ostringstream line;
+        line << std::fixed;
+        auto newLine = [&]() {
+            lines.push_back(line.str());
+            line.str("");
+        };
+        line << engine.name();
+        newLine();
+        line << ruleToString(engine.runningRule()) << "  " << engine.width() << "x" << engine.height() << "  generation " << generation;
+        newLine();
+        line << std::setprecision(1) << num_frame / interval << " fps  " << 1000.0 * interval / num_frame << " ms/frame  "
+             << pacer.droppedFrames() << " dropped";
+        newLine();
+        line << std::setprecision(0) << generations_per_second << " gen/s  " << std::setprecision(3)
+             << generations_per_second * engine.width() * engine.height() / 1e9 << " G cell updates/s";
+        newLine();
+        line << "step " << std::setprecision(3) << pacer.cpuMsPerGeneration() << " ms/gen cpu  " << pacer.gpuMsPerGeneration() << " gpu";
+        newLine();
+        line << "display " << display_ms << " ms gpu";
+        newLine();
+        // dying states are not hashed
+        if (engine.runningRule().states == 2)
+        {
+            line << "population " << population;
+            newLine();
+        }
+        line << std::setprecision(0) << "memory " << residentMemoryMb() << " MB";
+        double video_memory = freeVideoMemoryMb();
+        if (video_memory >= 0.0)
+        {
+            line << "  gpu " << video_memory << " MB free";
+        }
+        newLine();
+        text.setLines(lines);
+
+        num_frame = 0;
+        last_update_time = current_time;
+        last_generations = pacer.steppedGenerations();
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+}
 
-    // load all OpenGL function pointers for glad
-    // ------------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+// namespace related to startup time measurement
+// NB: see namespace fps for design-decision explanation
+namespace startup
+{
+    std::chrono::steady_clock::time_point begin;
+    double shader_wait_ms{0.0};
+    GLsync first_generation_fence{nullptr};
+    bool reported{false};
+
+    /**
+     * To be called once the first generation has been submitted
+     * */
+    void markFirstGeneration()
     {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        if (!reported && first_generation_fence == nullptr)
+        {
+            first_generation_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
     }
 
-    // Create vertex shader
-    // ------------------------------------------
-    std::string vertex_shader_content = tryGetShaderContent("src/shaders/vertex.glsl");
-    const char *vertex_shader_source = vertex_shader_content.c_str();
-    unsigned int vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader_id, 1, &vertex_shader_source, NULL);
-    glCompileShader(vertex_shader_id);
+    /**
+     * Print the time to first generation once the gpu has completed it, never blocks
+     * */
+    void reportWhenDone(int compiled_programs, int cached_programs)
+    {
+        if (reported || first_generation_fence == nullptr)
+        {
+            return;
+        }
+        if (glClientWaitSync(first_generation_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            return;
+        }
+        glDeleteSync(first_generation_fence);
+        first_generation_fence = nullptr;
+        reported = true;
+
+        double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "time to first generation " << elapsed_ms << "ms | waited " << shader_wait_ms << "ms on shaders ("
+                  << compiled_programs << " compiled, " << cached_programs << " from cache)" << std::endl;
+    }
+}
+
+// namespace related to the export of the display pass, recording is toggled with the R key
+// NB: see namespace fps for design-decision explanation
+namespace record
+{
+    RecordSettings settings;
+    std::unique_ptr<FrameRecorder> recorder;
+}
+
+// namespace related to the simulated rule and to the engine computing it
+// the N key cycles through rule_presets then extended_rule_presets, the C key cycles through the engines (see EngineKind)
+// NB: see namespace fps for design-decision explanation
+namespace simulation
+{
+    int grid_width{0};
+    int grid_height{0};
+    long generation{0};
+    // the space key pauses the simulation, it is also paused when a cycle is detected or the target generation reached
+    bool paused{false};
+    // 0 to run forever
+    long target_generation{0};
+
+    int preset_index{0};
+    LifeRule rule{rule_presets[0].rule};
+
+    // the A key switches to the heat-map display, the age of each cell is then tracked in its texel
+    bool track_age{false};
+
+    EngineKind engine_kind{EngineKind::GpuFragment};
+    bool engine_switch_requested{false};
+    // the bitsliced kernels run on every cpu, --threads <n> to use less of them
+    int cpu_threads{0};
+
+    const NamedRule &preset(int index)
+    {
+        int binary_count = std::size(rule_presets);
+        return index < binary_count ? rule_presets[index] : extended_rule_presets[index - binary_count];
+    }
 
-    // checking if shader was successfully built
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertex_shader_id, GL_COMPILE_STATUS, &success);
-    if (!success)
+    void selectNextPreset()
     {
-        glGetShaderInfoLog(vertex_shader_id, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n"
-                  << infoLog << std::endl;
+        preset_index = (preset_index + 1) % (std::size(rule_presets) + std::size(extended_rule_presets));
+        rule = preset(preset_index).rule;
+        std::cout << "rule " << preset(preset_index).name << " (" << ruleToString(rule) << ")" << std::endl;
     }
+}
 
-    // Create fragment shader
-    // ------------------------------------------
-    std::string fragment_shader_content = tryGetShaderContent("src/shaders/fragment.glsl");
-    const char *fragment_shader_source = fragment_shader_content.c_str();
+// namespace related to the edition of the grid: the left mouse button paints cells, the right one erases them, the
+// scroll wheel sets the size of the brush and the number keys stamp the built-in patterns under the cursor
+// dragging with shift held selects a rectangle, ctrl + C or ctrl + X copies or cuts it into the clipboard, ctrl + V
+// pastes the clipboard centered on the cursor, T turns and F flips the pasted cells
+// NB: see namespace fps for design-decision explanation
+namespace editing
+{
+    // edits of the current frame, applied right before the step
+    std::unique_ptr<CellEdits> edits;
+    int brush_radius{1};
+    const int max_brush_radius = 64;
+    // a stroke continues from the cell under the cursor during the last frame
+    bool stroking{false};
+    int last_x{0};
+    int last_y{0};
+
+    std::unique_ptr<Clipboard> clipboard;
+    bool selecting{false};
+    bool has_selection{false};
+    int anchor_x{0};
+    int anchor_y{0};
+    int corner_x{0};
+    int corner_y{0};
+    // copies and pastes are done by the engine with the edits of the frame
+    bool copy_requested{false};
+    bool cut_requested{false};
+    bool paste_requested{false};
+    int paste_x{0};
+    int paste_y{0};
+
+    /**
+     * Cell of the grid under the cursor, the grid is stretched over the whole window with its row 0 at the bottom
+     * */
+    void cursorCell(GLFWwindow *window, int &x, int &y)
+    {
+        double cursor_x, cursor_y;
+        glfwGetCursorPos(window, &cursor_x, &cursor_y);
+        int window_width, window_height;
+        glfwGetWindowSize(window, &window_width, &window_height);
+        x = int(std::floor(cursor_x / window_width * simulation::grid_width));
+        y = int(std::floor((1.0 - cursor_y / window_height) * simulation::grid_height));
+    }
+
+    /**
+     * Selected rectangle, clipped to the grid, return false if there is none
+     * */
+    bool selection(int &x, int &y, int &width, int &height)
+    {
+        x = std::max(std::min(anchor_x, corner_x), 0);
+        y = std::max(std::min(anchor_y, corner_y), 0);
+        width = std::min(std::max(anchor_x, corner_x), simulation::grid_width - 1) - x + 1;
+        height = std::min(std::max(anchor_y, corner_y), simulation::grid_height - 1) - y + 1;
+        return has_selection && width > 0 && height > 0;
+    }
+
+    /**
+     * Outline the selection over the display, with scissored clears of the framebuffer of screen_width x screen_height
+     * */
+    void drawSelection(int screen_width, int screen_height)
+    {
+        int x, y, width, height;
+        if (!selection(x, y, width, height))
+        {
+            return;
+        }
+        int left = x * screen_width / simulation::grid_width;
+        int right = (x + width) * screen_width / simulation::grid_width;
+        int bottom = y * screen_height / simulation::grid_height;
+        int top = (y + height) * screen_height / simulation::grid_height;
+        glEnable(GL_SCISSOR_TEST);
+        glClearColor(0.2f, 0.6f, 1.0f, 1.0f);
+        glScissor(left, bottom, right - left, 1);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glScissor(left, top - 1, right - left, 1);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glScissor(left, bottom, 1, top - bottom);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glScissor(right - 1, bottom, 1, top - bottom);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+    }
+}
 
-    unsigned int fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader_id, 1, &fragment_shader_source, NULL);
-    glCompileShader(fragment_shader_id);
+// namespace related to the scripted runs: the initial grid (random from a seed, or a pattern file), the snapshots written
+// on the way, the run without any window that exits at the target generation, enabled with --headless, and the log of
+// the hash of every generation, written with --hash-log <file> and checked against an earlier one with --check-log <file>
+// NB: see namespace fps for design-decision explanation
+namespace scenario
+{
+    // drawn from the random device unless given with --seed, and printed so that any run can be replayed
+    uint64_t seed{0};
+    bool has_seed{false};
+    // centered on an empty grid instead of the random one when given with --pattern
+    Pattern pattern;
+    bool has_pattern{false};
 
-    glGetShaderiv(fragment_shader_id, GL_COMPILE_STATUS, &success);
+    HashLog hash_log;
 
-    if (!success)
+    // every generation is hashed, instead of the last one of each frame
+    bool logging()
     {
-        glGetShaderInfoLog(fragment_shader_id, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n"
-                  << infoLog << std::endl;
+        return hash_log.isOpen() || hash_log.hasReference();
     }
 
-    // Create fragment shader
-    // ------------------------------------------
-    std::string disp_fragment_shader_content = tryGetShaderContent("src/shaders/dispFragment.glsl");
-    const char *disp_fragment_shader_source = disp_fragment_shader_content.c_str();
+    void logHash(long generation, const StateHash &hash)
+    {
+        bool was_diverged = hash_log.firstDivergence() >= 0;
+        if (!hash_log.record(generation, hash) && !was_diverged)
+        {
+            std::cout << "generation " << generation << " differs from the reference log (population " << hash.population << ")" << std::endl;
+        }
+    }
+
+    /**
+     * Write what changed the course of the run to the log
+     * */
+    void noteEvent(const std::string &event, long generation)
+    {
+        hash_log.note(event + " at generation " + std::to_string(generation));
+    }
+
+    /**
+     * Tell whether the run agreed with the reference log, return false if it did not
+     * */
+    bool reportCheck()
+    {
+        if (!hash_log.hasReference())
+        {
+            return true;
+        }
+        // a run that never met a generation of the reference checked nothing, which is no agreement
+        if (hash_log.checkedGenerations() == 0)
+        {
+            std::cout << "no generation of the run is in the reference log" << std::endl;
+            return false;
+        }
+        std::cout << "checked " << hash_log.checkedGenerations() << " generations against the reference log";
+        if (hash_log.firstDivergence() >= 0)
+        {
+            std::cout << ", the first difference is at generation " << hash_log.firstDivergence() << std::endl;
+            return false;
+        }
+        std::cout << ", all of them match" << std::endl;
+        return true;
+    }
+
+    /**
+     * Log the hashes still in flight, before they get discarded or their engine replaced, waits for them
+     * */
+    void flushHashes(LifeEngine &engine)
+    {
+        if (!logging())
+        {
+            return;
+        }
+        // the blocking hash returns once every earlier hash is complete
+        engine.hash();
+        long generation;
+        StateHash hash;
+        while (engine.pollHash(generation, hash))
+        {
+            logHash(generation, hash);
+        }
+    }
+
+    bool headless{false};
+    // every n-th generation is written to <prefix>_<generation>.pgm, 0 for none
+    long snapshot_interval{0};
+    std::string snapshot_prefix{"snapshot/generation"};
+    // where every ShaderCache reads its sources, relative to the working directory unless absolute
+    std::string shader_directory{"src/shaders"};
+
+    /**
+     * Number of generations to step from generation, at most generations, without going past the next snapshot
+     * */
+    long untilSnapshot(long generation, long generations)
+    {
+        if (snapshot_interval <= 0)
+        {
+            return generations;
+        }
+        return std::min(generations, snapshot_interval - generation % snapshot_interval);
+    }
 
-    unsigned int disp_fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(disp_fragment_shader_id, 1, &disp_fragment_shader_source, NULL);
-    glCompileShader(disp_fragment_shader_id);
+    /**
+     * Write the current generation of the engine if it is a snapshot one, reads the state back
+     * */
+    void snapshotIfDue(LifeEngine &engine, long generation)
+    {
+        if (snapshot_interval <= 0 || generation % snapshot_interval != 0)
+        {
+            return;
+        }
+        std::vector<uint8_t> cells(size_t(engine.width()) * engine.height());
+        engine.store(cells.data());
+        if (!writeSnapshot(snapshot_prefix, generation, cells.data(), engine.width(), engine.height()))
+        {
+            std::cout << "could not write the snapshot of generation " << generation << " to " << snapshot_prefix << std::endl;
+        }
+    }
+}
 
-    glGetShaderiv(disp_fragment_shader_id, GL_COMPILE_STATUS, &success);
+// namespace related to cycle detection, which stops runs that settled into still lifes and oscillators
+// NB: see namespace fps for design-decision explanation
+namespace cycle
+{
+    CycleAction action{CycleAction::Stop};
+    CycleDetector detector;
 
-    if (!success)
+    /**
+     * Feed the hash of a generation to the detector and apply the action once a cycle is found
+     * */
+    void record(long generation, const StateHash &hash)
     {
-        glGetShaderInfoLog(disp_fragment_shader_id, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::DISP_FRAGMENT::COMPILATION_FAILED\n"
-                  << infoLog << std::endl;
+        if (!detector.add(generation, hash))
+        {
+            return;
+        }
+        std::cout << "cycle of period " << detector.period() << " since generation " << detector.cycleStart()
+                  << " (population " << hash.population << ")" << std::endl;
+
+        if (action == CycleAction::Report)
+        {
+            return;
+        }
+        if (action == CycleAction::FastForward && simulation::target_generation > simulation::generation)
+        {
+            // states repeat every period, only the remainder has to be simulated
+            long remaining = detector.generationsToSimulate(simulation::generation, simulation::target_generation);
+            std::cout << "fast-forwarding to generation " << simulation::target_generation << ", " << remaining << " generations left to simulate" << std::endl;
+            simulation::generation = simulation::target_generation - remaining;
+            scenario::noteEvent("fast-forward to " + std::to_string(simulation::generation), generation);
+            return;
+        }
+        simulation::paused = true;
     }
+}
+
+// namespace related to the batched soup search, started with --soup-search instead of the interactive simulation
+// NB: see namespace fps for design-decision explanation
+namespace soup
+{
+    bool enabled{false};
+    SoupSearchSettings settings;
+    // generations stepped between two event polls
+    const int generations_per_batch = 16;
+}
+
+// namespace related to the comparison of the engines, started with --benchmark instead of the interactive simulation
+// NB: see namespace fps for design-decision explanation
+namespace benchmark
+{
+    bool enabled{false};
+    long generations{1000};
+}
+
+// namespace related to the headless run split across processes, enabled with --domain <processes> [--halo <rows>]
+// NB: see namespace fps for design-decision explanation
+namespace domain
+{
+    bool enabled{false};
+    DomainSettings settings;
+}
+
+// namespace related to the headless run streaming a state file, enabled with --out-of-core <file>
+// --size <width>x<height> applies to both bounded headless runs, --generations <n> to every headless run
+// NB: see namespace fps for design-decision explanation
+namespace out_of_core
+{
+    bool enabled{false};
+    OutOfCoreSettings settings;
+}
+
+// namespace related to the headless run of an unbounded world, enabled with --sparse
+// NB: see namespace fps for design-decision explanation
+namespace sparse
+{
+    bool enabled{false};
+    SparseSettings settings;
+}
 
-    unsigned int disp_shader_program_id = glCreateProgram();
-    glAttachShader(disp_shader_program_id, vertex_shader_id);
-    glAttachShader(disp_shader_program_id, disp_fragment_shader_id);
-    glLinkProgram(disp_shader_program_id);
-    glGetProgramiv(disp_shader_program_id, GL_LINK_STATUS, &success);
-    if (!success)
+/**
+ * Return a random grid, one byte per cell (0 for dead, 255 for alive)
+ * The cells only depend on the seed and the grid size, whatever the machine and its standard library (the
+ * distributions of <random> are not specified): rows come from seedRow, as in the domain decomposition and out-of-core runs
+ **/
+std::vector<uint8_t> generateSeed(int width, int height, uint64_t seed)
+{
+    int words_per_row = (width + 63) / 64;
+    std::vector<uint64_t> words(words_per_row);
+    std::vector<uint8_t> cells(size_t(width) * height);
+    for (int y = 0; y < height; ++y)
     {
-        glGetShaderInfoLog(disp_shader_program_id, 512, NULL, infoLog);
-        std::cout << "ERROR::DISP_SHADER::PROGRAM::LINKING_FAILED\n"
-                  << infoLog << std::endl;
+        seedRow(words.data(), words_per_row, seed, y);
+        for (int x = 0; x < width; ++x)
+        {
+            cells[size_t(y) * width + x] = (words[x / 64] >> (x % 64)) & 1 ? 255 : 0;
+        }
     }
+    return cells;
+}
 
-    // linking shader within a common Shader program
-    unsigned int shader_program_id = glCreateProgram();
-    glAttachShader(shader_program_id, vertex_shader_id);
-    glAttachShader(shader_program_id, fragment_shader_id);
-    glLinkProgram(shader_program_id);
-    glGetProgramiv(shader_program_id, GL_LINK_STATUS, &success);
-    if (!success)
+/**
+ * Return the first generation of the run: the pattern file centered on an empty grid, or a random grid
+ **/
+std::vector<uint8_t> initialCells(int width, int height)
+{
+    if (!scenario::has_pattern)
+    {
+        return generateSeed(width, height, scenario::seed);
+    }
+    const Pattern &pattern = scenario::pattern;
+    if (pattern.width > width || pattern.height > height)
+    {
+        std::cout << "the pattern " << pattern.name << " (" << pattern.width << "x" << pattern.height << ") is cropped to the grid" << std::endl;
+    }
+    // the grid stores its bottom row first, the pattern its top row first
+    std::vector<uint8_t> cells(size_t(width) * height, 0);
+    int left = (width - pattern.width) / 2;
+    int top = (height + pattern.height) / 2 - 1;
+    for (int y = 0; y < pattern.height; ++y)
     {
-        glGetShaderInfoLog(shader_program_id, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n"
-                  << infoLog << std::endl;
+        for (int x = 0; x < pattern.width; ++x)
+        {
+            int column = left + x;
+            int row = top - y;
+            if (column >= 0 && column < width && row >= 0 && row < height)
+            {
+                cells[size_t(row) * width + column] = pattern.cells[size_t(y) * pattern.width + x];
+            }
+        }
     }
-    // once they are loaded into the shader program, we can get rid of initial shaders
-    glDeleteShader(vertex_shader_id);
-    glDeleteShader(disp_fragment_shader_id);
-    glDeleteShader(fragment_shader_id);
+    return cells;
+}
 
+/**
+ * Create the vertex array of a square covering the whole viewport, used by every pass
+ **/
+unsigned int createQuad(unsigned int &VBO, unsigned int &EBO)
+{
     // setting up vertex data, configuring vertex attributes
     // 4 vertices to create 2 triangles
     // each "line" has this shape
@@ -216,75 +722,11 @@ int main()
         1, 2, 3  // second triangle
     };
 
-    unsigned int
-        VBO, // VBO = vertex buffer object
-        VAO, // VAO = vertex array object
-        EBO, // EBO = Element buffer object
-        FBO; // FBO = Frame buffer object
+    unsigned int VAO; // VAO = vertex array object
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    // framebuffer
-    glGenFramebuffers(1, &FBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-
-    /**
-     * creating a first texture. Initially, it will contain random data to initialise the simulation
-     * */
-    unsigned int first_texture;
-    glGenTextures(1, &first_texture);
-    glBindTexture(GL_TEXTURE_2D, first_texture);
-
-    // Creating random data
-    int nb_pixel = screen::width * screen::height;
-    float *data = {new float[nb_pixel]{}};
-    for (int i = 0; i < nb_pixel; ++i)
-    {
-
-        data[i] = dist(mt);
-    }
-    // loading data into texture
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, screen::width, screen::height, 0, GL_RED, GL_HALF_FLOAT, data);
-    // freeing data because texture makes an inner copy
-    delete[] data;
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    // linking first_texture to the first color entry of the framebuffer
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, first_texture, 0);
-
-    unsigned int secondTexture;
-    glGenTextures(1, &secondTexture);
-    glBindTexture(GL_TEXTURE_2D, secondTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, screen::width, screen::height, 0, GL_RED, GL_HALF_FLOAT, 0);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    // linking secondTexture to the first color entry of the framebuffer
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, secondTexture, 0);
-
-    GLenum status;
-    status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    switch (status)
-    {
-    case GL_FRAMEBUFFER_COMPLETE:
-        break;
-    default:
-        std::cout << "error while checking framebuffer" << status << std::endl;
-    }
-
-    int compiling_error = glGetError();
-
-    if (compiling_error != GL_NO_ERROR)
-    {
-
-        std::cout << "glGetError :" << compiling_error << std::endl;
-    }
-
     // bindings
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -304,116 +746,743 @@ int main()
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
+    return VAO;
+}
 
-    glUseProgram(shader_program_id);
-
-    std::cout << "launching main loop" << std::endl;
-
-    int current_color_attachment = GL_COLOR_ATTACHMENT1;
-
-    int current_source_texture = first_texture;
-    int current_destination_texture = secondTexture;
-
-    glBindVertexArray(VAO);
+/**
+ * Search soups until every requested soup settled, or until the window is closed
+ **/
+int runSoupSearch(GLFWwindow *window)
+{
+    ShaderCache shader_cache(scenario::shader_directory);
+    unsigned int VBO, EBO;
+    unsigned int VAO = createQuad(VBO, EBO);
 
-    // render loop
-    // -----------
-    while (!glfwWindowShouldClose(window))
+    if (!simulation::rule.isBinary())
     {
+        std::cout << "the soup search only runs rules of two states on the 8 neighbours" << std::endl;
+        return -1;
+    }
 
-        fps::countFPS();
+    int result = 0;
+    {
+        SoupSearch search(shader_cache, VAO, soup::settings, simulation::rule, ruleDefines(simulation::rule));
+        if (search.isValid())
+        {
+            std::cout << "searching soups of " << ruleToString(simulation::rule) << " in " << soup::settings.universes_x * soup::settings.universes_y
+                      << " universes of " << soup::settings.universe_size << "x" << soup::settings.universe_size << ", seed " << soup::settings.seed << std::endl;
+            while (!glfwWindowShouldClose(window) && !search.isFinished())
+            {
+                search.step(soup::generations_per_batch);
+                search.report();
+                glfwPollEvents();
+            }
+            search.report(true);
+        }
+        else
+        {
+            result = -1;
+        }
+    }
 
-        // input
-        // -----
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    shader_cache.deletePrograms();
+    return result;
+}
+
+/**
+ * Create an engine of the given kind continuing the run of the current one, return null if it is not available
+ **/
+std::unique_ptr<LifeEngine> continueRun(LifeEngine &current, EngineKind kind, ShaderCache &shader_cache, unsigned int quad_vao)
+{
+    std::unique_ptr<LifeEngine> engine = makeEngine(kind, shader_cache, quad_vao, current.width(), current.height(),
+                                                    simulation::rule, simulation::track_age, simulation::cpu_threads);
+    // switching engines is rare enough to wait for the programs of the new one
+    if (!engine || !engine->finishPrograms())
+    {
+        return nullptr;
+    }
+    std::vector<uint8_t> cells(size_t(current.width()) * current.height());
+    current.store(cells.data());
+    engine->load(cells.data());
+    std::cout << engine->name() << std::endl;
+    return engine;
+}
+
+/**
+ * Step the same seed on every available engine and report their speed, their final states have to be the same
+ **/
+int runBenchmark()
+{
+    ShaderCache shader_cache(scenario::shader_directory);
+    unsigned int VBO, EBO;
+    unsigned int VAO = createQuad(VBO, EBO);
+
+    std::vector<uint8_t> seed_cells = initialCells(simulation::grid_width, simulation::grid_height);
+    std::cout << "stepping " << benchmark::generations << " generations of " << ruleToString(simulation::rule) << " on " << simulation::grid_width
+              << "x" << simulation::grid_height << std::endl;
+
+    int result = 0;
+    bool has_reference = false;
+    StateHash reference;
+    for (EngineKind kind : {EngineKind::GpuFragment, EngineKind::GpuCompute, EngineKind::Cpu, EngineKind::CpuLookup})
+    {
+        std::unique_ptr<LifeEngine> engine = makeEngine(kind, shader_cache, VAO, simulation::grid_width, simulation::grid_height,
+                                                        simulation::rule, false, simulation::cpu_threads);
+        if (!engine || !engine->finishPrograms())
+        {
+            continue;
+        }
+        engine->load(seed_cells.data());
+        // an extra first generation builds the helper programs and starts the cpu workers, it is not measured
+        engine->step(1);
+        engine->hash();
+
+        auto begin = std::chrono::steady_clock::now();
+        engine->step(benchmark::generations);
+        // waits for the last generation
+        StateHash hash = engine->hash();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        double generations_per_second = benchmark::generations / seconds;
+        std::cout << engine->name() << ": " << generations_per_second << " generations/s, "
+                  << generations_per_second * simulation::grid_width * simulation::grid_height / 1e9 << " billion cell updates/s | population "
+                  << hash.population << ", hash " << std::hex << hash.hash << std::dec << std::endl;
+        if (!has_reference)
+        {
+            reference = hash;
+            has_reference = true;
+        }
+        else if (!(hash == reference))
+        {
+            std::cout << "the " << engine->name() << " does not agree with the first engine" << std::endl;
+            result = -1;
+        }
+    }
+
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    shader_cache.deletePrograms();
+    return result;
+}
+
+/**
+ * Step the selected engine to the target generation without displaying anything, write the snapshots on the way and
+ * report the last state
+ **/
+int runHeadless()
+{
+    ShaderCache shader_cache(scenario::shader_directory);
+    unsigned int VBO, EBO;
+    unsigned int VAO = createQuad(VBO, EBO);
+
+    int result = 0;
+    {
+        std::unique_ptr<LifeEngine> engine = makeEngine(simulation::engine_kind, shader_cache, VAO, simulation::grid_width, simulation::grid_height,
+                                                        simulation::rule, false, simulation::cpu_threads);
+        if (engine && engine->finishPrograms())
+        {
+            std::vector<uint8_t> cells = initialCells(simulation::grid_width, simulation::grid_height);
+            engine->load(cells.data());
+            std::cout << "stepping " << simulation::target_generation << " generations of " << ruleToString(simulation::rule) << " on "
+                      << simulation::grid_width << "x" << simulation::grid_height << " with the " << engine->name() << std::endl;
+
+            auto begin = std::chrono::steady_clock::now();
+            scenario::snapshotIfDue(*engine, simulation::generation);
+            scenario::noteEvent(engine->name(), simulation::generation);
+            bool logging = scenario::logging();
+            // the last generation of every batch goes to the cycle detector, for two-state rules as in the interactive run
+            bool detecting = engine->runningRule().states == 2;
+            if (logging)
+            {
+                engine->submitHash(simulation::generation);
+            }
+            while (simulation::generation < simulation::target_generation && !simulation::paused)
+            {
+                // the gpu engines queue every generation of a step, batches keep that queue short
+                long generations = scenario::untilSnapshot(simulation::generation, std::min(simulation::target_generation - simulation::generation, 1024L));
+                if (logging)
+                {
+                    // one generation at a time, every one of them goes to the log
+                    generations = 1;
+                }
+                engine->step(int(generations));
+                simulation::generation += generations;
+                if (logging || detecting)
+                {
+                    engine->submitHash(simulation::generation);
+                    long hashed_generation;
+                    StateHash state_hash;
+                    while (engine->pollHash(hashed_generation, state_hash))
+                    {
+                        if (logging)
+                        {
+                            scenario::logHash(hashed_generation, state_hash);
+                        }
+                        if (detecting)
+                        {
+                            // stops the loop, or moves the generation forward
+                            cycle::record(hashed_generation, state_hash);
+                        }
+                    }
+                }
+                scenario::snapshotIfDue(*engine, simulation::generation);
+            }
+            scenario::flushHashes(*engine);
+            // waits for the last generation
+            StateHash hash = engine->hash();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            std::cout << "generation " << simulation::generation << " | population " << hash.population << ", hash " << std::hex << hash.hash
+                      << std::dec << " | " << simulation::generation / seconds << " generations/s" << std::endl;
+            if (!scenario::reportCheck())
+            {
+                result = -1;
+            }
+        }
+        else
+        {
+            result = -1;
+        }
+    }
+
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    shader_cache.deletePrograms();
+    return result;
+}
+
+/**
+ * Spread the options over the namespaces above, size the grid and the window, and draw a seed when none is given
+ * Return false, after telling why, if the options can't make a run
+ **/
+bool applyOptions(Options &options)
+{
+    simulation::engine_kind = options.engine_kind;
+    simulation::rule = options.rule;
+    simulation::grid_width = options.width;
+    simulation::grid_height = options.height;
+    simulation::cpu_threads = options.threads;
+    if (options.has_generations)
+    {
+        simulation::target_generation = options.generations;
+        benchmark::generations = options.generations;
+    }
+    cycle::action = options.cycle_action;
+    scenario::seed = options.seed;
+    scenario::has_seed = options.has_seed;
+    scenario::pattern = std::move(options.pattern);
+    scenario::has_pattern = options.has_pattern;
+    scenario::snapshot_interval = options.snapshot_interval;
+    scenario::snapshot_prefix = options.snapshot_prefix;
+    scenario::shader_directory = options.shader_directory;
+    scenario::headless = options.headless;
+    if (!options.hash_log_path.empty() && !scenario::hash_log.open(options.hash_log_path))
+    {
+        std::cout << "could not create the hash log " << options.hash_log_path << std::endl;
+        return false;
+    }
+    if (!options.check_log_path.empty() && !scenario::hash_log.loadReference(options.check_log_path))
+    {
+        std::cout << "could not read any generation from the reference log " << options.check_log_path << std::endl;
+        return false;
+    }
+    pacing::swap_mode = options.swap_mode;
+    pacing::enabled = options.paced;
+    pacing::target_rate = options.target_rate;
+    overlay::enabled = options.overlay;
+    record::settings = options.record_settings;
+    soup::enabled = options.soup_search;
+    soup::settings = options.soup_settings;
+    benchmark::enabled = options.benchmark;
+    domain::enabled = options.domain;
+    domain::settings = options.domain_settings;
+    out_of_core::enabled = options.out_of_core;
+    out_of_core::settings = options.out_of_core_settings;
+    sparse::enabled = options.sparse;
+    sparse::settings = options.sparse_settings;
+
+    // the grid has the size of the window by default, a larger grid is displayed scaled down by a power of two
+    if (simulation::grid_width == 0)
+    {
+        simulation::grid_width = screen::width;
+        simulation::grid_height = screen::height;
+    }
+    else
+    {
+        screen::set_dimensions(simulation::grid_width, simulation::grid_height);
+        while (screen::width > 1024 || screen::height > 1024)
+        {
+            screen::set_dimensions(std::max(1u, screen::width / 2), std::max(1u, screen::height / 2));
+        }
+    }
+    // the universes of the soup search tile the grid when its size is given, the cells past the last universe are left out
+    if (soup::enabled && options.width != 0)
+    {
+        soup::settings.universes_x = options.width / soup::settings.universe_size;
+        soup::settings.universes_y = options.height / soup::settings.universe_size;
+        if (soup::settings.universes_x == 0 || soup::settings.universes_y == 0)
+        {
+            std::cout << "the soup search needs a grid of at least one universe of " << soup::settings.universe_size << "x"
+                      << soup::settings.universe_size << " cells" << std::endl;
+            return false;
+        }
+    }
+    if (!scenario::has_seed)
+    {
+        scenario::seed = std::random_device()();
+    }
+    if (!scenario::has_pattern && !soup::enabled && !domain::enabled && !out_of_core::enabled && !sparse::enabled)
+    {
+        std::cout << "seed " << scenario::seed << std::endl;
+    }
+    scenario::hash_log.note(std::to_string(simulation::grid_width) + "x" + std::to_string(simulation::grid_height) + " " + ruleToString(simulation::rule) + ", " +
+                            (scenario::has_pattern ? "pattern " + scenario::pattern.name : "seed " + std::to_string(scenario::seed)));
+    if (!simulation::rule.fitsGrid(simulation::grid_width, simulation::grid_height))
+    {
+        std::cout << "the neighbourhood of " << ruleToString(simulation::rule) << " is larger than the " << simulation::grid_width << "x"
+                  << simulation::grid_height << " grid" << std::endl;
+        return false;
+    }
+    if (scenario::headless && simulation::target_generation <= 0)
+    {
+        std::cout << "--headless needs --generations <n>" << std::endl;
+        return false;
+    }
+    // the other runs do not hash their generations, a log or a check would silently hold nothing
+    if (scenario::logging() && (domain::enabled || out_of_core::enabled || sparse::enabled || soup::enabled || benchmark::enabled))
+    {
+        std::cout << "--hash-log and --check-log only apply to the interactive and the headless runs" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Display the simulation and step it until the window is closed, the keyboard and the mouse drive the run
+ * (see processInput and the callbacks)
+ **/
+int runInteractive(GLFWwindow *window)
+{
+    // Create the engine and the renderer
+    // ------------------------------------------
+    // every program is a variant of its sources, compiled at most once and reloaded from the disk cache on later runs
+    // the engine and the renderer only request their programs: the driver builds them (on its own threads when it
+    // supports parallel compilation) while the seed is generated and the textures are allocated, we only wait for
+    // them right before the main loop
+    ShaderCache shader_cache(scenario::shader_directory);
+
+    // Creating random data on another thread, one byte per cell
+    // ------------------------------------------
+    std::future<std::vector<uint8_t>> seed = std::async(std::launch::async, initialCells, simulation::grid_width, simulation::grid_height);
+
+    unsigned int
+        VBO, // VBO = vertex buffer object
+        EBO; // EBO = Element buffer object
+    unsigned int VAO = createQuad(VBO, EBO);
+
+    // the rule is baked into the programs of the engine, and its number of states into the display program
+    LifeRule program_rule = simulation::rule;
+    bool program_track_age = simulation::track_age;
+    Renderer renderer(shader_cache, VAO, program_rule, program_track_age);
+    TextOverlay text_overlay(shader_cache, VAO);
+    std::unique_ptr<LifeEngine> engine = makeEngine(simulation::engine_kind, shader_cache, VAO, simulation::grid_width, simulation::grid_height,
+                                                    program_rule, program_track_age, simulation::cpu_threads);
+    if (!engine)
+    {
+        // the gpu engine runs everything
+        simulation::engine_kind = EngineKind::GpuFragment;
+        engine = makeEngine(simulation::engine_kind, shader_cache, VAO, simulation::grid_width, simulation::grid_height,
+                            program_rule, program_track_age, simulation::cpu_threads);
+        if (!engine)
+        {
+            return -1;
+        }
+    }
+
+    int compiling_error = glGetError();
+
+    if (compiling_error != GL_NO_ERROR)
+    {
+
+        std::cout << "glGetError :" << compiling_error << std::endl;
+    }
+
+    // loading the seed into the engine, textures make an inner copy
+    std::vector<uint8_t> seed_cells = seed.get();
+    engine->load(seed_cells.data());
+
+    // everything else is ready, now waiting for the programs
+    auto shader_wait_begin = std::chrono::steady_clock::now();
+    bool display_ready = renderer.finishPrograms() && text_overlay.finishPrograms();
+    bool engine_ready = engine->finishPrograms();
+    startup::shader_wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shader_wait_begin).count();
+    if (!display_ready || !engine_ready)
+    {
+        return -1;
+    }
+
+    // shaders edited while running are rebuilt and swapped in place
+    ShaderWatcher shader_watcher(scenario::shader_directory);
+
+    scenario::snapshotIfDue(*engine, simulation::generation);
+    scenario::noteEvent(engine->name(), simulation::generation);
+    if (scenario::logging())
+    {
+        engine->submitHash(simulation::generation);
+    }
+    std::cout << "launching main loop" << std::endl;
+
+    // generations stepped per frame, and frames presented late
+    FramePacer pacer;
+    GpuTimer display_timer;
+
+    editing::edits = std::make_unique<CellEdits>(simulation::grid_width, simulation::grid_height);
+    editing::clipboard = std::make_unique<Clipboard>();
+
+    // the recorder captures frames at the initial window size, whatever the later window size
+    record::recorder = std::make_unique<FrameRecorder>(record::settings, screen::width, screen::height);
+
+    // render loop
+    // -----------
+    while (!glfwWindowShouldClose(window))
+    {
+
+        pacing::apply(pacer);
+        fps::countFPS(pacer);
+
+        // input
+        // -----
         processInput(window);
 
-        // render
+        // swapping programs
         // --------------------------------------
-        // selecting the framebuffer not to write on the screen
-        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-        // selecting the current colorAttachment to draw to (will select the output texture)
-        glDrawBuffer(current_color_attachment);
-        // use the game-of-life related shader
-        glUseProgram(shader_program_id);
-        // cleaning previous frame
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        // cleaning color buffer
-        glClear(GL_COLOR_BUFFER_BIT);
+        // an edited shader or another rule only requests new variants, the current programs keep running until
+        // the new ones are built, and stay in use if they fail to build. The state is never touched
+        if (shader_watcher.poll())
+        {
+            renderer.reloadShaders();
+            text_overlay.reloadShaders();
+            engine->reloadShaders();
+        }
+        if (!simulation::rule.fitsGrid(simulation::grid_width, simulation::grid_height))
+        {
+            std::cout << "the neighbourhood of " << ruleToString(simulation::rule) << " is larger than the grid, keeping " << ruleToString(program_rule) << std::endl;
+            simulation::rule = program_rule;
+        }
+        if (!(program_rule == simulation::rule) || program_track_age != simulation::track_age)
+        {
+            if (!(program_rule == simulation::rule))
+            {
+                cycle::detector.reset();
+                scenario::noteEvent("rule " + ruleToString(simulation::rule), simulation::generation);
+            }
+            // both programs read the texel encoding
+            program_rule = simulation::rule;
+            program_track_age = simulation::track_age;
+            renderer.setDisplay(program_rule, program_track_age);
+            if (engine->supports(program_rule))
+            {
+                engine->setRule(program_rule, program_track_age);
+            }
+            else
+            {
+                std::cout << "the " << engine->name() << " can't run " << ruleToString(program_rule) << std::endl;
+                // the gpu engine runs every rule
+                scenario::flushHashes(*engine);
+                if (std::unique_ptr<LifeEngine> gpu_engine = continueRun(*engine, EngineKind::GpuFragment, shader_cache, VAO))
+                {
+                    engine = std::move(gpu_engine);
+                    scenario::noteEvent(engine->name(), simulation::generation);
+                    simulation::engine_kind = EngineKind::GpuFragment;
+                    pacer.restart();
+                }
+            }
+        }
+        if (engine->updatePrograms())
+        {
+            // earlier states were computed with other dynamics, they can't prove a cycle anymore
+            cycle::detector.reset();
+        }
+        renderer.updatePrograms();
+        text_overlay.updatePrograms();
 
-        // now, we need to pass the source texture as parameter as uniform
-        // --------------------------------------
-        // for location 0
-        glActiveTexture(GL_TEXTURE0); // Texture unit 0
-        // bind source texture
-        glBindTexture(GL_TEXTURE_2D, current_source_texture); // setting the associated texture
-        // pass it to the shader
-        int source_texture_location = glGetUniformLocation(shader_program_id, "source_texture"); // setting the associated texture
-        glUniform1i(source_texture_location, 0);                                                 // 0 first uniform value
-
-        // Now, rendering to the screen to use the shader
-        // --------------------------------------
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (simulation::engine_switch_requested)
+        {
+            simulation::engine_switch_requested = false;
+            scenario::flushHashes(*engine);
+            // skipping the engines that are not available
+            for (EngineKind kind = nextEngine(simulation::engine_kind); kind != simulation::engine_kind; kind = nextEngine(kind))
+            {
+                if (std::unique_ptr<LifeEngine> next_engine = continueRun(*engine, kind, shader_cache, VAO))
+                {
+                    engine = std::move(next_engine);
+                    scenario::noteEvent(engine->name(), simulation::generation);
+                    simulation::engine_kind = kind;
+                    pacer.restart();
+                    break;
+                }
+            }
+        }
+
+        // the cells copied, edited and pasted during the frame are written at once, before the step
+        // a copy comes first, a cut then clears what it copied
+        int selection_x, selection_y, selection_width, selection_height;
+        bool has_selection = editing::selection(selection_x, selection_y, selection_width, selection_height);
+        if (editing::copy_requested && has_selection)
+        {
+            engine->copy(selection_x, selection_y, selection_width, selection_height, *editing::clipboard);
+            std::cout << "copied " << selection_width << "x" << selection_height << " cells" << std::endl;
+        }
+        bool cut = editing::copy_requested && editing::cut_requested && has_selection;
+        editing::copy_requested = false;
+        editing::cut_requested = false;
+        bool edited = !editing::edits->empty() || editing::paste_requested || cut;
+        if (edited)
+        {
+            // the states before the edit are still logged
+            scenario::flushHashes(*engine);
+            scenario::noteEvent("edit", simulation::generation);
+        }
+        if (cut)
+        {
+            engine->clear(selection_x, selection_y, selection_width, selection_height);
+        }
+        if (!editing::edits->empty())
+        {
+            engine->edit(*editing::edits);
+            editing::edits->clear();
+        }
+        if (editing::paste_requested)
+        {
+            engine->paste(*editing::clipboard, editing::paste_x, editing::paste_y);
+            editing::paste_requested = false;
+        }
+        if (edited)
+        {
+            // the hashes in flight are of states that no longer lead to the current one
+            engine->discardHashes();
+            cycle::detector.reset();
+        }
+
+        // the state is only stepped when the simulation runs, the display pass always happens
+        bool stepping = !simulation::paused;
+        if (stepping)
+        {
+            // as many generations as the pacer says fit in a frame, without going past the target
+            int generations = pacer.generationsPerFrame();
+            if (simulation::target_generation > 0)
+            {
+                generations = int(std::min<long>(generations, simulation::target_generation - simulation::generation));
+            }
+            // nor past the next snapshot
+            generations = std::max(int(scenario::untilSnapshot(simulation::generation, generations)), 1);
+
+            pacer.beginStep();
+            if (scenario::logging())
+            {
+                // every generation goes to the log
+                for (int i = 0; i < generations; ++i)
+                {
+                    engine->step(1);
+                    engine->submitHash(simulation::generation + i + 1);
+                }
+            }
+            else
+            {
+                engine->step(generations);
+            }
+            simulation::generation += generations;
+            startup::markFirstGeneration();
+
+            // hashing the new state, the hashes of the gpu engines are read back a few frames later
+            // only the last generation of the frame is hashed, the cycle detector copes with the stride
+            // dying states are not hashed, a repeated set of alive cells does not prove a cycle of a Generations rule
+            if (engine->runningRule().states == 2 && !scenario::logging())
+            {
+                engine->submitHash(simulation::generation);
+            }
+            pacer.endStep(generations);
+            scenario::snapshotIfDue(*engine, simulation::generation);
+        }
+        long hashed_generation;
+        StateHash state_hash;
+        while (engine->pollHash(hashed_generation, state_hash))
+        {
+            scenario::logHash(hashed_generation, state_hash);
+            if (engine->runningRule().states == 2)
+            {
+                cycle::record(hashed_generation, state_hash);
+            }
+            overlay::population = state_hash.population;
+        }
+        if (simulation::target_generation > 0 && simulation::generation >= simulation::target_generation && !simulation::paused)
+        {
+            std::cout << "reached generation " << simulation::generation << std::endl;
+            simulation::paused = true;
+        }
 
-        // writting now back in default frame buffer
+        // writting now in default frame buffer
         // --------------------------------------
-        // using the display shader, that will only display stored texture
-        glUseProgram(disp_shader_program_id);
-        // going back to default framebuffer
-
-        // for location 0
-        glActiveTexture(GL_TEXTURE0); // Texture unit 0
-        // bind source texture
-        glBindTexture(GL_TEXTURE_2D, current_source_texture); // setting the associated texture
-
-        int previous_texture_location = glGetUniformLocation(disp_shader_program_id, "previous_texture"); // setting the associated texture
-        glUniform1i(previous_texture_location, 0);                                                        // 0 first uniform value
-
-        // pass it to the shader
-        // for location 1
-        glActiveTexture(GL_TEXTURE1); // Texture unit 1
-        //  bind destination texture
-        glBindTexture(GL_TEXTURE_2D, current_destination_texture); // setting the associated texture
-        int current_texture_location = glGetUniformLocation(disp_shader_program_id, "current_texture");
-        glUniform1i(current_texture_location, 1);
-
-        // going back to default framebuffer
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        glViewport(0, 0, screen::width, screen::height);
+
+        // when recording, the display pass goes through the recorder offscreen target before reaching the screen
+        if (record::recorder->isRecording())
+        {
+            record::recorder->bindTarget();
+        }
 
-        // swaping with framebuffer color is going to receive next iteration
-        if (current_color_attachment == GL_COLOR_ATTACHMENT1)
+        if (overlay::enabled)
         {
-            current_color_attachment = GL_COLOR_ATTACHMENT0;
+            display_timer.begin();
+            renderer.draw(*engine);
+            display_timer.end();
         }
         else
         {
-            current_color_attachment = GL_COLOR_ATTACHMENT1;
+            renderer.draw(*engine);
         }
 
-        // but now, we need to use the new texture as the next source
+        if (record::recorder->isRecording())
+        {
+            record::recorder->capture(screen::width, screen::height);
+        }
+
+        // drawn on screen only, recordings show the grid alone
+        editing::drawSelection(screen::width, screen::height);
+        if (overlay::enabled)
+        {
+            // one measure per frame, polled as they come
+            display_timer.poll(overlay::display_ms);
+            overlay::update(text_overlay, *engine, pacer, simulation::generation);
+            text_overlay.draw(screen::width, screen::height);
+        }
 
-        std::swap(current_source_texture, current_destination_texture);
+        startup::reportWhenDone(shader_cache.compiledCount(), shader_cache.loadedCount());
 
         // swap buffer to display the painted frame
         glfwSwapBuffers(window);
+        pacer.endFrame();
         // poll IO events (mouse, keyboard)
         glfwPollEvents();
     }
 
+    // flushing frames and hashes still in flight before the context goes away
+    record::recorder.reset();
+    editing::clipboard.reset();
+    scenario::flushHashes(*engine);
+    bool check_passed = scenario::reportCheck();
+    engine.reset();
+
     // cleaning up remaining objects
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteTextures(1, &first_texture);
-    glDeleteTextures(1, &secondTexture);
-    glDeleteProgram(shader_program_id);
-    glDeleteProgram(disp_shader_program_id);
+    shader_cache.deletePrograms();
+    return check_passed ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    startup::begin = std::chrono::steady_clock::now();
+
+    Options options;
+    if (!parseOptions(std::vector<std::string>(argv + 1, argv + argc), options))
+    {
+        return -1;
+    }
+    if (options.help)
+    {
+        printUsage();
+        return 0;
+    }
+    if (!applyOptions(options))
+    {
+        return -1;
+    }
+
+    if (options.topology)
+    {
+        // placement of the workers of the cpu engine
+        ThreadedStepper(simulation::grid_width, simulation::grid_height, simulation::cpu_threads).report(std::cout);
+        return 0;
+    }
+
+    // the headless runs are on the cpu only, they need no window
+    if (domain::enabled)
+    {
+        return runDomainDecomposition(domain::settings, simulation::rule);
+    }
+    if (out_of_core::enabled)
+    {
+        return runOutOfCore(out_of_core::settings, simulation::rule);
+    }
+    if (sparse::enabled)
+    {
+        return runSparseWorld(sparse::settings, simulation::rule);
+    }
+
+    // Initialize and configure glfw
+    // ------------------------------------------
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // the soup search, the benchmark and the headless run never display anything
+    glfwWindowHint(GLFW_VISIBLE, soup::enabled || benchmark::enabled || scenario::headless ? GLFW_FALSE : GLFW_TRUE);
 
+    // create glfw window
+    // ------------------------------------------
+    GLFWwindow *window = glfwCreateWindow(screen::width, screen::height, "Game of no life", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    // the grid keeps its size, resizing the window only scales the display
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetScrollCallback(window, scrollCallback);
+
+    // load all OpenGL function pointers for glad
+    // ------------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    // load opengl functions that are not part of 3.3 core, when the driver has them
+    glext::load((GLADloadproc)glfwGetProcAddress);
+
+    if (soup::enabled)
+    {
+        int result = runSoupSearch(window);
+        glfwTerminate();
+        return result;
+    }
+    if (benchmark::enabled)
+    {
+        int result = runBenchmark();
+        glfwTerminate();
+        return result;
+    }
+    if (scenario::headless)
+    {
+        int result = runHeadless();
+        glfwTerminate();
+        return result;
+    }
+
+    int result = runInteractive(window);
     // freeing GLFW ressources
     glfwTerminate();
-    return 0;
+    return result;
 }
 
 /**
@@ -425,6 +1494,143 @@ void processInput(GLFWwindow *window)
     {
         glfwSetWindowShouldClose(window, true);
     }
+
+    // dragging with shift held selects a rectangle, until the button is released
+    bool left_button = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    bool shift = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS;
+    if (left_button && (shift || editing::selecting))
+    {
+        int x, y;
+        editing::cursorCell(window, x, y);
+        if (!editing::selecting)
+        {
+            editing::anchor_x = x;
+            editing::anchor_y = y;
+            editing::selecting = true;
+            editing::has_selection = true;
+        }
+        editing::corner_x = x;
+        editing::corner_y = y;
+    }
+    else
+    {
+        editing::selecting = false;
+    }
+
+    // painting while the left button is held, erasing while the right one is
+    bool paint = left_button && !editing::selecting;
+    bool erase = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+    if (paint || erase)
+    {
+        int x, y;
+        editing::cursorCell(window, x, y);
+        if (!editing::stroking)
+        {
+            editing::last_x = x;
+            editing::last_y = y;
+        }
+        editing::edits->paint(editing::last_x, editing::last_y, x, y, editing::brush_radius, paint);
+        editing::last_x = x;
+        editing::last_y = y;
+    }
+    editing::stroking = paint || erase;
+}
+
+/**
+ * Handle one-shot key presses, that should not be repeated while the key is held
+ * */
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+    {
+        simulation::paused = !simulation::paused;
+    }
+    if (key == GLFW_KEY_N && action == GLFW_PRESS)
+    {
+        simulation::selectNextPreset();
+    }
+    if (key == GLFW_KEY_A && action == GLFW_PRESS)
+    {
+        simulation::track_age = !simulation::track_age;
+        std::cout << (simulation::track_age ? "heat-map display" : "default display") << std::endl;
+    }
+    bool control = mods & GLFW_MOD_CONTROL;
+    if (key == GLFW_KEY_C && action == GLFW_PRESS && !control)
+    {
+        simulation::engine_switch_requested = true;
+    }
+    if ((key == GLFW_KEY_C || key == GLFW_KEY_X) && action == GLFW_PRESS && control)
+    {
+        editing::copy_requested = true;
+        editing::cut_requested = key == GLFW_KEY_X;
+    }
+    if (key == GLFW_KEY_V && action == GLFW_PRESS && control && !editing::clipboard->empty())
+    {
+        // centered on the cursor
+        int x, y;
+        editing::cursorCell(window, x, y);
+        editing::paste_x = x - editing::clipboard->pastedWidth() / 2;
+        editing::paste_y = y - editing::clipboard->pastedHeight() / 2;
+        editing::paste_requested = true;
+    }
+    if (key == GLFW_KEY_T && action == GLFW_PRESS)
+    {
+        editing::clipboard->rotate();
+        std::cout << "clipboard turned " << 90 * editing::clipboard->quarterTurns() << " degrees" << (editing::clipboard->isFlipped() ? ", flipped" : "") << std::endl;
+    }
+    if (key == GLFW_KEY_F && action == GLFW_PRESS)
+    {
+        editing::clipboard->flip();
+        std::cout << "clipboard turned " << 90 * editing::clipboard->quarterTurns() << " degrees" << (editing::clipboard->isFlipped() ? ", flipped" : "") << std::endl;
+    }
+    if (key == GLFW_KEY_V && action == GLFW_PRESS && !control)
+    {
+        pacing::swap_mode = nextSwapMode(pacing::swap_mode);
+        pacing::swap_mode_changed = true;
+    }
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        pacing::enabled = !pacing::enabled;
+        pacing::settings_changed = true;
+        if (!pacing::enabled)
+        {
+            std::cout << "one generation per frame" << std::endl;
+        }
+    }
+    if (key == GLFW_KEY_O && action == GLFW_PRESS)
+    {
+        overlay::enabled = !overlay::enabled;
+        overlay::restart = true;
+    }
+    if (key >= GLFW_KEY_1 && key <= GLFW_KEY_9 && action == GLFW_PRESS && key - GLFW_KEY_1 < int(builtinPatterns().size()))
+    {
+        // centered on the cursor
+        const Pattern &pattern = builtinPatterns()[key - GLFW_KEY_1];
+        int x, y;
+        editing::cursorCell(window, x, y);
+        editing::edits->stamp(pattern, x - pattern.width / 2, y + pattern.height / 2);
+        std::cout << "stamped a " << pattern.name << std::endl;
+    }
+    if (key == GLFW_KEY_R && action == GLFW_PRESS)
+    {
+        if (record::recorder->isRecording())
+        {
+            record::recorder->stop();
+        }
+        else
+        {
+            record::recorder->start();
+        }
+    }
+}
+
+/**
+ * Scrolling up grows the brush, scrolling down shrinks it
+ * */
+void scrollCallback(GLFWwindow *window, double x_offset, double y_offset)
+{
+    editing::brush_radius = std::clamp(editing::brush_radius + (y_offset > 0 ? 1 : -1), 0, editing::max_brush_radius);
+    std::cout << "brush radius " << editing::brush_radius << std::endl;
 }
 
 /**
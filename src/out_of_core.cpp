@@ -0,0 +1,315 @@
+#include "out_of_core.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <iostream> // needed for std::cout
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "cpu_engine.hpp"
+#include "state_hash.hpp"
+
+namespace
+{
+    const char file_magic[8] = {'G', 'O', 'L', 'B', 'I', 'T', 'S', '1'};
+
+    /**
+     * Rows of 64 bit words follow the header, row after row
+     **/
+    struct FileHeader
+    {
+        char magic[8];
+        int64_t width;
+        int64_t height;
+        int64_t generation;
+        uint8_t padding[32];
+    };
+    static_assert(sizeof(FileHeader) == 64);
+
+    /**
+     * A state file mapped in memory, rows are paged in and out by the kernel
+     **/
+    class MappedGrid
+    {
+    public:
+        ~MappedGrid() { unmap(); }
+
+        /**
+         * Map an existing file, or create one of the given size when width is not 0
+         **/
+        bool open(const std::string &path, long new_width = 0, long new_height = 0)
+        {
+            bool create = new_width != 0;
+            int fd = ::open(path.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+            if (fd < 0)
+            {
+                return false;
+            }
+            FileHeader file_header{};
+            if (create)
+            {
+                std::memcpy(file_header.magic, file_magic, sizeof(file_magic));
+                file_header.width = new_width;
+                file_header.height = new_height;
+                size = sizeof(FileHeader) + size_t(new_width / 64) * new_height * sizeof(uint64_t);
+                if (ftruncate(fd, size) != 0)
+                {
+                    ::close(fd);
+                    return false;
+                }
+            }
+            else if (pread(fd, &file_header, sizeof(file_header), 0) != sizeof(file_header) ||
+                     std::memcmp(file_header.magic, file_magic, sizeof(file_magic)) != 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            else
+            {
+                size = sizeof(FileHeader) + size_t(file_header.width / 64) * file_header.height * sizeof(uint64_t);
+            }
+
+            void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (mapping == MAP_FAILED)
+            {
+                return false;
+            }
+            base = static_cast<uint8_t *>(mapping);
+            if (create)
+            {
+                header() = file_header;
+            }
+            width = header().width;
+            height = header().height;
+            words_per_row = int(width / 64);
+            return true;
+        }
+
+        void unmap()
+        {
+            if (base != nullptr)
+            {
+                munmap(base, size);
+                base = nullptr;
+            }
+        }
+
+        FileHeader &header() { return *reinterpret_cast<FileHeader *>(base); }
+
+        uint64_t *row(long y) { return reinterpret_cast<uint64_t *>(base + sizeof(FileHeader)) + size_t(y) * words_per_row; }
+
+        // a pass reads the file once, in order: pages can be read ahead and dropped early
+        void adviseSequential() { madvise(base, size, MADV_SEQUENTIAL); }
+
+        // start writing rows back to the disk without waiting
+        void flushRows(long first, long count)
+        {
+            uintptr_t page = uintptr_t(sysconf(_SC_PAGESIZE));
+            uintptr_t begin = uintptr_t(row(first)) & ~(page - 1);
+            uintptr_t end = uintptr_t(row(first + count));
+            msync(reinterpret_cast<void *>(begin), end - begin, MS_ASYNC);
+        }
+
+        long width{0}, height{0};
+        int words_per_row{0};
+
+    private:
+        uint8_t *base{nullptr};
+        size_t size{0};
+    };
+
+    /**
+     * Rows of a band with its halo rows, and the grid of its next generation
+     **/
+    struct BandBuffer
+    {
+        long first_row{0};
+        int rows{0};
+        BitGrid grids[2];
+        int current{0};
+    };
+
+    void loadBand(MappedGrid &source, BandBuffer &band, long first_row, int rows, int halo)
+    {
+        band.first_row = first_row;
+        band.rows = rows;
+        band.current = 0;
+        int local_rows = rows + 2 * halo;
+        if (band.grids[0].height != local_rows)
+        {
+            band.grids[0] = BitGrid(int(source.width), local_rows);
+            band.grids[1] = BitGrid(int(source.width), local_rows);
+        }
+        for (int row = 0; row < local_rows; ++row)
+        {
+            long y = ((first_row - halo + row) % source.height + source.height) % source.height;
+            std::memcpy(band.grids[0].row(row), source.row(y), source.words_per_row * sizeof(uint64_t));
+        }
+    }
+
+    /**
+     * Generation t is valid on local rows t to local_rows - 1 - t, the band rows are valid after halo generations
+     **/
+    void stepBand(BandBuffer &band, int generations, RowKernel kernel, const LifeRule &rule)
+    {
+        int local_rows = band.grids[0].height;
+        for (int t = 1; t <= generations; ++t)
+        {
+            const BitGrid &source = band.grids[band.current];
+            BitGrid &destination = band.grids[1 - band.current];
+            for (int row = t; row < local_rows - t; ++row)
+            {
+                kernel(source.row(row - 1), source.row(row), source.row(row + 1), destination.row(row), source.words_per_row, rule);
+            }
+            band.current = 1 - band.current;
+        }
+    }
+
+    void storeBand(MappedGrid &destination, const BandBuffer &band, int halo, StateHash *hash)
+    {
+        const BitGrid &grid = band.grids[band.current];
+        for (int row = 0; row < band.rows; ++row)
+        {
+            std::memcpy(destination.row(band.first_row + row), grid.row(halo + row), destination.words_per_row * sizeof(uint64_t));
+        }
+        destination.flushRows(band.first_row, band.rows);
+
+        if (hash == nullptr)
+        {
+            return;
+        }
+        uint32_t low = 0, high = 0;
+        long population = 0;
+        for (int row = 0; row < band.rows; ++row)
+        {
+            const uint64_t *words = grid.row(halo + row);
+            for (int w = 0; w < grid.words_per_row; ++w)
+            {
+                for (uint64_t word = words[w]; word != 0; word &= word - 1)
+                {
+                    uint64_t cell = cellHash(w * 64 + __builtin_ctzll(word), uint32_t(band.first_row + row));
+                    low += uint32_t(cell);
+                    high += uint32_t(cell >> 32);
+                    population++;
+                }
+            }
+        }
+        *hash = combineHashes(*hash, {(uint64_t(high) << 32) | low, population});
+    }
+
+    /**
+     * Step every band of source generations times into destination
+     **/
+    void runPass(MappedGrid &source, MappedGrid &destination, int band_rows, int generations, const LifeRule &rule, StateHash *hash)
+    {
+        RowKernel kernel = selectRowKernel(rule);
+        long band_count = (source.height + band_rows - 1) / band_rows;
+        auto bandSize = [&](long band)
+        { return int(std::min<long>(band_rows, source.height - band * band_rows)); };
+
+        BandBuffer buffers[2];
+        loadBand(source, buffers[0], 0, bandSize(0), generations);
+        int current = 0;
+        for (long band = 0; band < band_count; ++band)
+        {
+            // the other buffer holds the previous band: written back, then reused for the next one
+            BandBuffer &other = buffers[1 - current];
+            std::future<void> io = std::async(std::launch::async, [&, band]()
+                                              {
+                if (band > 0)
+                {
+                    storeBand(destination, other, generations, hash);
+                }
+                if (band + 1 < band_count)
+                {
+                    loadBand(source, other, (band + 1) * band_rows, bandSize(band + 1), generations);
+                } });
+            stepBand(buffers[current], generations, kernel, rule);
+            io.wait();
+            current = 1 - current;
+        }
+        storeBand(destination, buffers[1 - current], generations, hash);
+    }
+}
+
+int runOutOfCore(const OutOfCoreSettings &settings, const LifeRule &rule)
+{
+    if (!rule.isBinary())
+    {
+        std::cout << "the out-of-core engine only runs rules of two states on the 8 neighbours" << std::endl;
+        return -1;
+    }
+
+    MappedGrid state;
+    if (access(settings.path.c_str(), F_OK) != 0)
+    {
+        if (settings.width % 64 != 0 || settings.width <= 0 || settings.height <= 0 || !state.open(settings.path, settings.width, settings.height))
+        {
+            std::cout << "failed to create " << settings.path << " (the width has to be a multiple of 64)" << std::endl;
+            return -1;
+        }
+        for (long y = 0; y < state.height; ++y)
+        {
+            seedRow(state.row(y), state.words_per_row, settings.seed, y);
+        }
+        std::cout << "seeded " << settings.path << " with " << state.width << "x" << state.height << " cells" << std::endl;
+    }
+    else if (!state.open(settings.path))
+    {
+        std::cout << "failed to open " << settings.path << ", not a state file" << std::endl;
+        return -1;
+    }
+    if (settings.band_rows < 1 || settings.block_generations < 1)
+    {
+        std::cout << "bands need at least one row and passes one generation" << std::endl;
+        return -1;
+    }
+    long width = state.width, height = state.height;
+    long generation = state.header().generation;
+    state.unmap();
+
+    std::string next_path = settings.path + ".next";
+    double grid_bytes = double(width / 8) * height;
+    StateHash hash;
+    auto begin = std::chrono::steady_clock::now();
+    for (long stepped = 0; stepped < settings.generations;)
+    {
+        int generations = int(std::min<long>(settings.block_generations, settings.generations - stepped));
+        bool last_pass = stepped + generations == settings.generations;
+        MappedGrid source, destination;
+        if (!source.open(settings.path) || !destination.open(next_path, width, height))
+        {
+            std::cout << "failed to map " << settings.path << " or " << next_path << std::endl;
+            return -1;
+        }
+        source.adviseSequential();
+
+        auto pass_begin = std::chrono::steady_clock::now();
+        runPass(source, destination, settings.band_rows, generations, rule, last_pass ? &hash : nullptr);
+        generation += generations;
+        destination.header().generation = generation;
+        destination.unmap();
+        source.unmap();
+        // the complete pass replaces the previous state, an interrupted one leaves it untouched
+        if (std::rename(next_path.c_str(), settings.path.c_str()) != 0)
+        {
+            std::cout << "failed to replace " << settings.path << std::endl;
+            return -1;
+        }
+        stepped += generations;
+
+        double pass_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pass_begin).count();
+        std::cout << "generation " << generation << " | pass of " << generations << " generations in " << pass_ms << "ms, "
+                  << 2 * grid_bytes / pass_ms / 1000.0 << "MB/s" << std::endl;
+    }
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "generation " << generation << ": population " << hash.population << ", hash " << std::hex << hash.hash << std::dec
+              << " | " << elapsed_ms << "ms, " << double(width) * height * settings.generations / elapsed_ms / 1e6 << " Gcells/s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "rule.hpp"
+
+struct OutOfCoreSettings
+{
+    // state file, created and seeded if it does not exist (its own size is used otherwise)
+    std::string path;
+    // size of a new state file, the width has to be a multiple of 64
+    long width{65536};
+    long height{65536};
+    long generations{64};
+    // rows stepped at once, two bands are in memory at any time
+    int band_rows{512};
+    // generations per pass over the file, each band then reads as many halo rows above and below it
+    int block_generations{8};
+    // a new file is seeded as the rows of DomainSettings with the same seed
+    uint64_t seed{1};
+};
+
+/**
+ * Step a bit-packed grid stored in a file, for grids that do not fit in memory
+ * The file is memory mapped, and streamed through the cpu engine band by band: while a band is stepped, an I/O
+ * thread writes the previous band back and loads the next one into a second buffer. Each band is stepped
+ * block_generations times per pass (it is loaded with as many halo rows on each side, whose valid part shrinks by
+ * one row per generation), so the disk is read and written once per block_generations generations.
+ * Passes write into <path>.next, renamed over the state file once complete
+ * Return 0 on success
+ **/
+int runOutOfCore(const OutOfCoreSettings &settings, const LifeRule &rule);
@@ -0,0 +1,181 @@
+#include "pattern.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+Pattern patternFromRows(const std::string &name, const char *rows)
+{
+    std::vector<std::string> lines(1);
+    for (const char *c = rows; *c != '\0'; ++c)
+    {
+        if (*c == '/')
+        {
+            lines.emplace_back();
+        }
+        else
+        {
+            lines.back().push_back(*c);
+        }
+    }
+
+    Pattern pattern;
+    pattern.name = name;
+    pattern.height = lines.size();
+    for (const std::string &line : lines)
+    {
+        pattern.width = std::max<int>(pattern.width, line.size());
+    }
+    pattern.cells.assign(pattern.width * pattern.height, 0);
+    for (int y = 0; y < pattern.height; ++y)
+    {
+        for (int x = 0; x < int(lines[y].size()); ++x)
+        {
+            pattern.cells[y * pattern.width + x] = lines[y][x] == 'o' ? 255 : 0;
+        }
+    }
+    return pattern;
+}
+
+bool readPatternFile(const std::string &path, Pattern &pattern)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        lines.push_back(line);
+    }
+
+    std::string name = path;
+    int width = 0, height = 0;
+    // alive cells, from the top left corner
+    std::vector<std::pair<int, int>> alive;
+    size_t first = 0;
+    // comments of both formats, #N and !Name: give the name of the pattern
+    while (first < lines.size() && (lines[first].empty() || lines[first][0] == '#' || lines[first][0] == '!'))
+    {
+        const std::string &comment = lines[first];
+        if (comment.rfind("#N ", 0) == 0 || comment.rfind("!Name: ", 0) == 0)
+        {
+            name = comment.substr(comment.find(' ') + 1);
+        }
+        first++;
+    }
+
+    if (first < lines.size() && lines[first][0] == 'x')
+    {
+        // header then runs: <count>b dead cells, <count>o alive ones (any other letter is a state of a multi-state
+        // rule), <count>$ ends rows, ! ends the pattern
+        std::string header;
+        for (char c : lines[first])
+        {
+            if (!std::isspace(static_cast<unsigned char>(c)))
+            {
+                header.push_back(c);
+            }
+        }
+        std::sscanf(header.c_str(), "x=%d,y=%d", &width, &height);
+
+        int x = 0, y = 0;
+        long count = 0;
+        bool ended = false;
+        for (size_t i = first + 1; i < lines.size() && !ended; ++i)
+        {
+            for (char c : lines[i])
+            {
+                int run = int(std::max(count, 1L));
+                if (std::isdigit(static_cast<unsigned char>(c)))
+                {
+                    count = count * 10 + (c - '0');
+                    continue;
+                }
+                if (c == '!')
+                {
+                    ended = true;
+                    break;
+                }
+                if (c == '$')
+                {
+                    y += run;
+                    x = 0;
+                }
+                else if (c == 'b' || c == '.')
+                {
+                    x += run;
+                }
+                else if (std::isalpha(static_cast<unsigned char>(c)))
+                {
+                    for (int n = 0; n < run; ++n)
+                    {
+                        alive.emplace_back(x++, y);
+                    }
+                }
+                count = 0;
+            }
+        }
+    }
+    else
+    {
+        int y = 0;
+        for (size_t i = first; i < lines.size(); ++i)
+        {
+            if (!lines[i].empty() && lines[i][0] == '!')
+            {
+                continue;
+            }
+            for (size_t x = 0; x < lines[i].size(); ++x)
+            {
+                if (lines[i][x] != '.' && !std::isspace(static_cast<unsigned char>(lines[i][x])))
+                {
+                    alive.emplace_back(int(x), y);
+                }
+            }
+            height = ++y;
+        }
+    }
+
+    if (alive.empty())
+    {
+        return false;
+    }
+    for (const auto &[x, y] : alive)
+    {
+        width = std::max(width, x + 1);
+        height = std::max(height, y + 1);
+    }
+    pattern.name = name;
+    pattern.width = width;
+    pattern.height = height;
+    pattern.cells.assign(size_t(width) * height, 0);
+    for (const auto &[x, y] : alive)
+    {
+        pattern.cells[size_t(y) * width + x] = 255;
+    }
+    return true;
+}
+
+const std::vector<Pattern> &builtinPatterns()
+{
+    static const std::vector<Pattern> patterns = {
+        patternFromRows("glider", ".o/..o/ooo"),
+        patternFromRows("lightweight spaceship", ".oooo/o...o/....o/o..o"),
+        patternFromRows("r-pentomino", ".oo/oo/.o"),
+        patternFromRows("acorn", ".o/...o/oo..ooo"),
+        patternFromRows("gosper glider gun",
+                        "........................o/......................o.o/............oo......oo............oo/"
+                        "...........o...o....oo............oo/oo........o.....o...oo/oo........o...o.oo....o.o/"
+                        "..........o.....o.......o/...........o...o/............oo"),
+    };
+    return patterns;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Small rectangle of cells, one byte per cell (0 for dead, 255 for alive), row after row from the top row
+ **/
+struct Pattern
+{
+    std::string name;
+    int width{0};
+    int height{0};
+    std::vector<uint8_t> cells;
+
+    bool get(int x, int y) const { return cells[y * width + x] != 0; }
+};
+
+/**
+ * Parse rows of 'o' (alive) and '.' (dead) separated by '/', shorter rows are padded with dead cells
+ **/
+Pattern patternFromRows(const std::string &name, const char *rows);
+
+/**
+ * Read a pattern file, either run length encoded (.rle, with its x = <width>, y = <height> header) or plain text
+ * (.cells, 'O' for alive cells and '.' for dead ones, '!' comment lines). Cells of any other state count as alive
+ * Return false if the file could not be read or holds no cell
+ **/
+bool readPatternFile(const std::string &path, Pattern &pattern);
+
+/**
+ * Patterns stamped with the number keys, in order
+ **/
+const std::vector<Pattern> &builtinPatterns();
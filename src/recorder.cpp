@@ -0,0 +1,426 @@
+#include "recorder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <filesystem> // needed to create the capture directory
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+    // png crc32 over the chunk type and data, table built on first use
+    uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc = 0xffffffffu)
+    {
+        static const std::array<uint32_t, 256> table = []
+        {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                {
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                t[n] = c;
+            }
+            return t;
+        }();
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    void putBigEndian(std::vector<uint8_t> &out, uint32_t value)
+    {
+        out.push_back(value >> 24);
+        out.push_back(value >> 16);
+        out.push_back(value >> 8);
+        out.push_back(value);
+    }
+
+    void writePngChunk(FILE *file, const char *type, const std::vector<uint8_t> &data)
+    {
+        std::vector<uint8_t> header;
+        putBigEndian(header, data.size());
+        header.insert(header.end(), type, type + 4);
+        fwrite(header.data(), 1, header.size(), file);
+        fwrite(data.data(), 1, data.size(), file);
+
+        uint32_t crc = crc32(header.data() + 4, 4);
+        crc = crc32(data.data(), data.size(), crc) ^ 0xffffffffu;
+        std::vector<uint8_t> footer;
+        putBigEndian(footer, crc);
+        fwrite(footer.data(), 1, footer.size(), file);
+    }
+}
+
+const char *recordFormatName(RecordFormat format)
+{
+    switch (format)
+    {
+    case RecordFormat::PngSequence:
+        return "png";
+    case RecordFormat::Y4m:
+        return "y4m";
+    }
+    return "";
+}
+
+bool parseRecordFormat(const char *name, RecordFormat &format)
+{
+    for (RecordFormat candidate : {RecordFormat::PngSequence, RecordFormat::Y4m})
+    {
+        if (std::string_view(name) == recordFormatName(candidate))
+        {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+FrameRecorder::FrameRecorder(const RecordSettings &settings, int width, int height)
+    : settings(settings), width(width), height(height)
+{
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    glGenTextures(1, &color_texture);
+    glBindTexture(GL_TEXTURE_2D, color_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color_texture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "error while checking recorder framebuffer" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // readback is done in RGBA because it is the fast path on every driver
+    slots.resize(std::max(1, settings.pbo_count));
+    for (PendingReadback &slot : slots)
+    {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    stop();
+    for (PendingReadback &slot : slots)
+    {
+        glDeleteBuffers(1, &slot.pbo);
+    }
+    glDeleteTextures(1, &color_texture);
+    glDeleteFramebuffers(1, &fbo);
+}
+
+bool FrameRecorder::start()
+{
+    if (recording)
+    {
+        return true;
+    }
+
+    y4m_is_pipe = settings.format == RecordFormat::Y4m && !settings.output.empty() && settings.output[0] == '|';
+    if (!y4m_is_pipe)
+    {
+        // the directory of the png files or of the y4m file
+        std::filesystem::path directory = std::filesystem::path(settings.output).parent_path();
+        if (!directory.empty())
+        {
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+        }
+    }
+
+    if (settings.format == RecordFormat::Y4m)
+    {
+        y4m_stream = y4m_is_pipe ? popen(settings.output.c_str() + 1, "w") : fopen(settings.output.c_str(), "wb");
+        if (y4m_stream == NULL)
+        {
+            std::cout << "could not open recording output " << settings.output << std::endl;
+            return false;
+        }
+        // full range BT.601, see writeY4mFrame
+        fprintf(y4m_stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444 XCOLORRANGE=FULL\n", width, height, settings.frame_rate);
+    }
+
+    frame_counter = 0;
+    stalled_frames = 0;
+    writer_done = false;
+    writer = std::thread(&FrameRecorder::writerLoop, this);
+    recording = true;
+    std::cout << "recording started to " << settings.output << std::endl;
+    return true;
+}
+
+void FrameRecorder::stop()
+{
+    if (!recording)
+    {
+        return;
+    }
+    recording = false;
+
+    // every frame already queued on the gpu is still written
+    harvest(true);
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        writer_done = true;
+    }
+    queue_changed.notify_all();
+    writer.join();
+
+    if (y4m_stream != NULL)
+    {
+        y4m_is_pipe ? pclose(y4m_stream) : fclose(y4m_stream);
+        y4m_stream = NULL;
+    }
+    std::cout << "recording stopped, " << frame_counter << " frames, render loop waited on the writer " << stalled_frames << " times" << std::endl;
+}
+
+void FrameRecorder::bindTarget()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+void FrameRecorder::capture(int screen_width, int screen_height)
+{
+    // showing the recorded frame on screen as well
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, screen_width, screen_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, screen_width, screen_height);
+
+    if (!recording)
+    {
+        return;
+    }
+
+    harvest(false);
+
+    // the ring is full: the oldest readback has to be waited for before reusing its buffer
+    PendingReadback &slot = slots[next_slot];
+    if (slot.fence != nullptr)
+    {
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        harvestSlot(slot);
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    // with a pack buffer bound, this only queues the copy and returns immediately
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame_index = frame_counter++;
+    next_slot = (next_slot + 1) % slots.size();
+}
+
+/**
+ * Hand over every finished readback to the writer thread, in submission order
+ **/
+void FrameRecorder::harvest(bool wait_for_all)
+{
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        PendingReadback &slot = slots[(next_slot + i) % slots.size()];
+        if (slot.fence == nullptr)
+        {
+            continue;
+        }
+        GLenum state = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait_for_all ? GL_TIMEOUT_IGNORED : 0);
+        if (state == GL_TIMEOUT_EXPIRED)
+        {
+            // later slots were submitted after this one, they can't be ready either
+            return;
+        }
+        harvestSlot(slot);
+    }
+}
+
+void FrameRecorder::harvestSlot(PendingReadback &slot)
+{
+    std::vector<uint8_t> buffer;
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if ((int)queue.size() >= settings.max_queued_frames)
+        {
+            // lossless recording: rather wait for the writer than drop a frame
+            stalled_frames++;
+            queue_changed.wait(lock, [this]
+                               { return (int)queue.size() < settings.max_queued_frames; });
+        }
+        if (!free_buffers.empty())
+        {
+            buffer = std::move(free_buffers.back());
+            free_buffers.pop_back();
+        }
+    }
+    buffer.resize(width * height * 4);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer.size(), GL_MAP_READ_BIT);
+    if (pixels != NULL)
+    {
+        std::copy_n(static_cast<const uint8_t *>(pixels), buffer.size(), buffer.data());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue.emplace_back(slot.frame_index, std::move(buffer));
+    }
+    queue_changed.notify_all();
+}
+
+void FrameRecorder::writerLoop()
+{
+    while (true)
+    {
+        std::pair<long, std::vector<uint8_t>> frame;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_changed.wait(lock, [this]
+                               { return !queue.empty() || writer_done; });
+            if (queue.empty())
+            {
+                return;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        queue_changed.notify_all();
+
+        writeFrame(frame.second, frame.first);
+
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        free_buffers.push_back(std::move(frame.second));
+    }
+}
+
+void FrameRecorder::writeFrame(const std::vector<uint8_t> &rgba, long frame_index)
+{
+    if (settings.format == RecordFormat::Y4m)
+    {
+        writeY4mFrame(rgba);
+    }
+    else
+    {
+        writePng(rgba, frame_index);
+    }
+}
+
+/**
+ * Write an RGB png made of stored (uncompressed) deflate blocks
+ * It is larger than a compressed png, but it is lossless and costs nearly nothing to produce
+ **/
+void FrameRecorder::writePng(const std::vector<uint8_t> &rgba, long frame_index)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s_%06ld.png", settings.output.c_str(), frame_index);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        std::cout << "could not write frame " << path << std::endl;
+        return;
+    }
+
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    fwrite(signature, 1, sizeof(signature), file);
+
+    std::vector<uint8_t> ihdr;
+    putBigEndian(ihdr, width);
+    putBigEndian(ihdr, height);
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8 bits per channel, RGB, deflate, no filter, no interlace
+    writePngChunk(file, "IHDR", ihdr);
+
+    // raw scanlines, top row first while opengl gives the bottom row first
+    size_t row_size = 1 + width * 3;
+    scratch.resize(row_size * height);
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t *source = rgba.data() + (size_t)(height - 1 - y) * width * 4;
+        uint8_t *destination = scratch.data() + y * row_size;
+        *destination++ = 0; // filter type none
+        for (int x = 0; x < width; ++x)
+        {
+            *destination++ = source[x * 4 + 0];
+            *destination++ = source[x * 4 + 1];
+            *destination++ = source[x * 4 + 2];
+        }
+    }
+
+    std::vector<uint8_t> idat{0x78, 0x01};
+    idat.reserve(scratch.size() + scratch.size() / 65535 * 5 + 16);
+    uint32_t adler_a = 1, adler_b = 0;
+    for (size_t offset = 0; offset < scratch.size(); offset += 65535)
+    {
+        size_t length = std::min<size_t>(65535, scratch.size() - offset);
+        bool last = offset + length == scratch.size();
+        idat.push_back(last ? 1 : 0);
+        idat.push_back(length & 0xff);
+        idat.push_back(length >> 8);
+        idat.push_back(~length & 0xff);
+        idat.push_back((~length >> 8) & 0xff);
+        idat.insert(idat.end(), scratch.begin() + offset, scratch.begin() + offset + length);
+
+        for (size_t i = offset; i < offset + length; ++i)
+        {
+            adler_a = (adler_a + scratch[i]) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+    }
+    putBigEndian(idat, (adler_b << 16) | adler_a);
+    writePngChunk(file, "IDAT", idat);
+    writePngChunk(file, "IEND", {});
+    fclose(file);
+}
+
+/**
+ * Write one frame as planar 4:4:4 full range BT.601 YCbCr
+ **/
+void FrameRecorder::writeY4mFrame(const std::vector<uint8_t> &rgba)
+{
+    size_t plane_size = (size_t)width * height;
+    scratch.resize(plane_size * 3);
+    uint8_t *luma = scratch.data();
+    uint8_t *blue_chroma = luma + plane_size;
+    uint8_t *red_chroma = blue_chroma + plane_size;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t *source = rgba.data() + (size_t)(height - 1 - y) * width * 4;
+        for (int x = 0; x < width; ++x)
+        {
+            int r = source[x * 4 + 0], g = source[x * 4 + 1], b = source[x * 4 + 2];
+            size_t i = (size_t)y * width + x;
+            // 16 bits fixed point coefficients
+            luma[i] = std::clamp((19595 * r + 38470 * g + 7471 * b + 32768) >> 16, 0, 255);
+            blue_chroma[i] = std::clamp(((-11059 * r - 21709 * g + 32768 * b + 32768) >> 16) + 128, 0, 255);
+            red_chroma[i] = std::clamp(((32768 * r - 27439 * g - 5329 * b + 32768) >> 16) + 128, 0, 255);
+        }
+    }
+
+    fputs("FRAME\n", y4m_stream);
+    fwrite(scratch.data(), 1, scratch.size(), y4m_stream);
+}
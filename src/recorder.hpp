@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glad/glad.h>         // needed to handle opengl function pointers
+#include <condition_variable> // needed to wake up the writer thread
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Output formats supported by the recorder
+ * - PngSequence writes one lossless png per frame (output is used as a file prefix)
+ * - Y4m streams raw 4:4:4 frames to a file, or to an encoder if output starts with '|'
+ *   (e.g. "|ffmpeg -i - -c:v ffv1 life.mkv")
+ **/
+enum class RecordFormat
+{
+    PngSequence,
+    Y4m
+};
+
+// png or y4m
+const char *recordFormatName(RecordFormat format);
+// return false if name is not one of the names above
+bool parseRecordFormat(const char *name, RecordFormat &format);
+
+struct RecordSettings
+{
+    RecordFormat format{RecordFormat::PngSequence};
+    std::string output{"capture/frame"};
+    int frame_rate{60};
+    // number of pixel buffer objects in flight, the readback of a frame is only waited for after this many frames
+    int pbo_count{3};
+    // number of frames the writer thread may lag behind before the render loop waits for it
+    int max_queued_frames{16};
+};
+
+/**
+ * Records the display pass without stalling the render loop
+ * The display pass is rendered into an offscreen framebuffer, blitted to the screen, then read back
+ * asynchronously through a ring of pixel buffer objects. Completed readbacks are handed over to a writer thread
+ * that encodes and writes them, so the simulation only waits if the disk or the encoder can't keep up
+ **/
+class FrameRecorder
+{
+public:
+    FrameRecorder(const RecordSettings &settings, int width, int height);
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder &) = delete;
+    FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+    bool start();
+    void stop();
+    bool isRecording() const { return recording; }
+
+    /**
+     * Select the offscreen target as destination of the display pass
+     **/
+    void bindTarget();
+
+    /**
+     * Blit the offscreen target to the default framebuffer and queue its readback
+     **/
+    void capture(int screen_width, int screen_height);
+
+private:
+    struct PendingReadback
+    {
+        unsigned int pbo{0};
+        GLsync fence{nullptr};
+        long frame_index{-1};
+    };
+
+    void harvest(bool wait_for_all);
+    void harvestSlot(PendingReadback &slot);
+    void writerLoop();
+    void writeFrame(const std::vector<uint8_t> &rgba, long frame_index);
+    void writePng(const std::vector<uint8_t> &rgba, long frame_index);
+    void writeY4mFrame(const std::vector<uint8_t> &rgba);
+
+    RecordSettings settings;
+    int width;
+    int height;
+    bool recording{false};
+
+    unsigned int fbo{0};
+    unsigned int color_texture{0};
+    std::vector<PendingReadback> slots;
+    int next_slot{0};
+    long frame_counter{0};
+    long stalled_frames{0};
+
+    // writer thread state, guarded by queue_mutex
+    std::thread writer;
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    std::deque<std::pair<long, std::vector<uint8_t>>> queue;
+    std::vector<std::vector<uint8_t>> free_buffers;
+    bool writer_done{false};
+
+    // only touched by the writer thread
+    FILE *y4m_stream{nullptr};
+    bool y4m_is_pipe{false};
+    std::vector<uint8_t> scratch;
+};
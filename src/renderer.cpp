@@ -0,0 +1,67 @@
+#include "renderer.hpp"
+
+namespace
+{
+    ShaderDefines displayDefines(const LifeRule &rule, bool track_age)
+    {
+        if (rule.states > 2)
+        {
+            return {{"STATES", std::to_string(rule.states)}};
+        }
+        return ageDefines(track_age && rule.isBinary());
+    }
+}
+
+Renderer::Renderer(ShaderCache &shader_cache, unsigned int quad_vao, const LifeRule &rule, bool track_age)
+    : shader_cache(shader_cache), quad_vao(quad_vao), program(shader_cache), packed_program(shader_cache)
+{
+    setDisplay(rule, track_age);
+}
+
+void Renderer::setDisplay(const LifeRule &rule, bool track_age)
+{
+    this->rule = rule;
+    this->track_age = track_age;
+    reloadShaders();
+}
+
+void Renderer::reloadShaders()
+{
+    program.request(shader_cache.requestProgram("vertex.glsl", "dispFragment.glsl", displayDefines(rule, track_age)));
+    packed_program.request(shader_cache.requestProgram("vertex.glsl", "dispFragment.glsl", {{"PACKED", "1"}}));
+}
+
+void Renderer::updatePrograms()
+{
+    program.update();
+    packed_program.update();
+}
+
+bool Renderer::finishPrograms()
+{
+    program.update(true);
+    packed_program.update(true);
+    return program.id() != 0 && packed_program.id() != 0;
+}
+
+void Renderer::draw(const LifeEngine &engine)
+{
+    // using the display shader, that will only display stored texture
+    unsigned int program_id = engine.cellsPerTexel() == 1 ? program.id() : packed_program.id();
+    glUseProgram(program_id);
+    glUniform2i(glGetUniformLocation(program_id, "grid_size"), engine.width(), engine.height());
+    glBindVertexArray(quad_vao);
+
+    // the previous generation on unit 0, the current one on unit 1
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, engine.previousTexture());
+    glUniform1i(glGetUniformLocation(program_id, "previous_texture"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, engine.currentTexture());
+    glUniform1i(glGetUniformLocation(program_id, "current_texture"), 1);
+    glActiveTexture(GL_TEXTURE0);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
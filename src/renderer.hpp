@@ -0,0 +1,33 @@
+#pragma once
+
+#include "life_engine.hpp"
+#include "shader.hpp"
+
+/**
+ * Display pass: draws the current generation of an engine over the bound framebuffer and viewport, cells born since
+ * the previous generation brighter (dispFragment.glsl)
+ * The display program reads the texel encoding, so it follows the rule and the age tracking of the engine. Like the
+ * game-of-life programs, a new variant replaces the current one once it is built. Engines with bit-packed textures
+ * are drawn by the PACKED variant, which only depends on the grid size
+ **/
+class Renderer
+{
+public:
+    Renderer(ShaderCache &shader_cache, unsigned int quad_vao, const LifeRule &rule, bool track_age);
+
+    void setDisplay(const LifeRule &rule, bool track_age);
+    void reloadShaders();
+    void updatePrograms();
+    // wait for the requested program, return false if there is nothing to draw with
+    bool finishPrograms();
+
+    void draw(const LifeEngine &engine);
+
+private:
+    ShaderCache &shader_cache;
+    unsigned int quad_vao;
+    ProgramSlot program;
+    ProgramSlot packed_program;
+    LifeRule rule;
+    bool track_age;
+};
@@ -0,0 +1,269 @@
+#include "rule.hpp"
+
+#include <cctype>
+#include <string>
+
+namespace
+{
+    /**
+     * Parse a list of neighbour counts ("236") into a bit mask, return false on anything but digits 0 to 8
+     **/
+    bool parseCounts(std::string_view digits, uint16_t &mask)
+    {
+        mask = 0;
+        for (char c : digits)
+        {
+            if (c < '0' || c > '8')
+            {
+                return false;
+            }
+            mask |= 1 << (c - '0');
+        }
+        return true;
+    }
+
+    bool parseNumber(std::string_view digits, int &value)
+    {
+        if (digits.empty() || digits.size() > 4)
+        {
+            return false;
+        }
+        value = 0;
+        for (char c : digits)
+        {
+            if (c < '0' || c > '9')
+            {
+                return false;
+            }
+            value = value * 10 + (c - '0');
+        }
+        return true;
+    }
+
+    // <min>..<max>
+    bool parseRange(std::string_view text, uint16_t &min, uint16_t &max)
+    {
+        size_t dots = text.find("..");
+        int low, high;
+        if (dots == std::string_view::npos || !parseNumber(text.substr(0, dots), low) || !parseNumber(text.substr(dots + 2), high))
+        {
+            return false;
+        }
+        min = low;
+        max = high;
+        return true;
+    }
+
+    /**
+     * R5,C0,M1,S34..58,B34..45,NM
+     **/
+    bool parseLargerThanLife(std::string_view text, LifeRule &rule)
+    {
+        LifeRule parsed{0, 0};
+        bool has_radius = false, has_birth = false, has_survival = false;
+        while (!text.empty())
+        {
+            size_t comma = text.find(',');
+            std::string_view token = text.substr(0, comma);
+            text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+            if (token.empty())
+            {
+                return false;
+            }
+
+            char key = std::toupper(token[0]);
+            std::string_view value = token.substr(1);
+            int number;
+            if (key == 'R' && parseNumber(value, number) && number >= 1 && number <= max_radius)
+            {
+                parsed.radius = number;
+                has_radius = true;
+            }
+            else if (key == 'C' && parseNumber(value, number) && number <= max_states)
+            {
+                // C0 and C2 both mean two states
+                parsed.states = number < 2 ? 2 : number;
+            }
+            else if (key == 'M' && (value == "0" || value == "1"))
+            {
+                parsed.include_centre = value == "1";
+            }
+            else if (key == 'S' && parseRange(value, parsed.survival_min, parsed.survival_max))
+            {
+                has_survival = true;
+            }
+            else if (key == 'B' && parseRange(value, parsed.birth_min, parsed.birth_max))
+            {
+                has_birth = true;
+            }
+            else if (key == 'N' && (value == "M" || value == "m"))
+            {
+                // Moore neighbourhood, the only one supported
+            }
+            else
+            {
+                return false;
+            }
+        }
+        if (!has_radius || !has_birth || !has_survival)
+        {
+            return false;
+        }
+
+        if (parsed.radius == 1)
+        {
+            // radius 1 ranges fit in the masks of the 8 neighbours
+            for (int n = 0; n <= 8; ++n)
+            {
+                int with_centre = parsed.include_centre ? n + 1 : n;
+                if (n >= parsed.birth_min && n <= parsed.birth_max)
+                {
+                    parsed.birth |= 1 << n;
+                }
+                if (with_centre >= parsed.survival_min && with_centre <= parsed.survival_max)
+                {
+                    parsed.survival |= 1 << n;
+                }
+            }
+            parsed.include_centre = false;
+            parsed.birth_min = parsed.birth_max = parsed.survival_min = parsed.survival_max = 0;
+        }
+        rule = parsed;
+        return true;
+    }
+
+    bool equalsIgnoringCase(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (std::tolower(a[i]) != std::tolower(b[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool parseRule(std::string_view text, LifeRule &rule)
+{
+    for (const NamedRule &preset : rule_presets)
+    {
+        if (equalsIgnoringCase(text, preset.name))
+        {
+            rule = preset.rule;
+            return true;
+        }
+    }
+    for (const NamedRule &preset : extended_rule_presets)
+    {
+        if (equalsIgnoringCase(text, preset.name))
+        {
+            rule = preset.rule;
+            return true;
+        }
+    }
+
+    if (!text.empty() && std::toupper(text[0]) == 'R')
+    {
+        return parseLargerThanLife(text, rule);
+    }
+
+    size_t slash = text.find('/');
+    if (slash == std::string_view::npos)
+    {
+        return false;
+    }
+    std::string_view left = text.substr(0, slash);
+    std::string_view right = text.substr(slash + 1);
+
+    // Generations rules have a third part, the number of states
+    int states = 2;
+    size_t second_slash = right.find('/');
+    if (second_slash != std::string_view::npos)
+    {
+        std::string_view count = right.substr(second_slash + 1);
+        if (!count.empty() && std::toupper(count[0]) == 'C')
+        {
+            count = count.substr(1);
+        }
+        if (!parseNumber(count, states) || states < 2 || states > max_states)
+        {
+            return false;
+        }
+        right = right.substr(0, second_slash);
+    }
+
+    uint16_t birth, survival;
+    if (!left.empty() && std::tolower(left[0]) == 'b')
+    {
+        // B3/S23
+        if (right.empty() || std::tolower(right[0]) != 's')
+        {
+            return false;
+        }
+        if (!parseCounts(left.substr(1), birth) || !parseCounts(right.substr(1), survival))
+        {
+            return false;
+        }
+    }
+    else if (!left.empty() && std::tolower(left[0]) == 's')
+    {
+        // S23/B3
+        if (right.empty() || std::tolower(right[0]) != 'b')
+        {
+            return false;
+        }
+        if (!parseCounts(left.substr(1), survival) || !parseCounts(right.substr(1), birth))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // 23/3, survival first
+        if (!parseCounts(left, survival) || !parseCounts(right, birth))
+        {
+            return false;
+        }
+    }
+
+    rule = LifeRule{birth, survival, states};
+    return true;
+}
+
+std::string ruleToString(const LifeRule &rule)
+{
+    if (rule.isLargerThanLife())
+    {
+        return "R" + std::to_string(rule.radius) + ",C" + std::to_string(rule.states == 2 ? 0 : rule.states) + ",M" + (rule.include_centre ? "1" : "0") +
+               ",S" + std::to_string(rule.survival_min) + ".." + std::to_string(rule.survival_max) +
+               ",B" + std::to_string(rule.birth_min) + ".." + std::to_string(rule.birth_max) + ",NM";
+    }
+
+    std::string text = "B";
+    for (int n = 0; n <= 8; ++n)
+    {
+        if (rule.birth >> n & 1)
+        {
+            text += char('0' + n);
+        }
+    }
+    text += "/S";
+    for (int n = 0; n <= 8; ++n)
+    {
+        if (rule.survival >> n & 1)
+        {
+            text += char('0' + n);
+        }
+    }
+    if (rule.states > 2)
+    {
+        text += "/C" + std::to_string(rule.states);
+    }
+    return text;
+}
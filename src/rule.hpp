@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Outer totalistic rule on the Moore neighborhood, written B.../S... (e.g. B3/S23 for Conway's game of life)
+ * Bit n of birth (resp. survival) is set if a dead (resp. alive) cell with n alive neighbours is alive at the next step
+ *
+ * Two families extend it:
+ * - Generations rules (B2/S/C3 for Brian's Brain): alive cells that do not survive go through the dying states 2 to
+ *   states - 1 before being dead. Dying cells are not counted as neighbours and can not be born
+ * - Larger than Life rules (R5,C0,M1,S34..58,B34..45,NM for Bosco's rule): neighbours are counted in a square of
+ *   radius up to max_radius, optionally including the cell itself, and compared to ranges instead of masks
+ **/
+struct LifeRule
+{
+    uint16_t birth{1 << 3};
+    uint16_t survival{(1 << 2) | (1 << 3)};
+    // number of states, 2 for the usual rules
+    int states{2};
+    // used instead of the masks when radius > 1
+    int radius{1};
+    bool include_centre{false};
+    uint16_t birth_min{0}, birth_max{0};
+    uint16_t survival_min{0}, survival_max{0};
+
+    // alive and dead only, on the 8 neighbours: the bit-packed kernels can run it
+    constexpr bool isBinary() const { return states == 2 && radius == 1; }
+    constexpr bool isLargerThanLife() const { return radius > 1; }
+    // the engines wrap the neighbourhood of a cell around the torus at most once, it can't be larger than the grid
+    constexpr bool fitsGrid(int width, int height) const { return 2 * radius + 1 <= width && 2 * radius + 1 <= height; }
+
+    constexpr bool operator==(const LifeRule &other) const
+    {
+        return birth == other.birth && survival == other.survival && states == other.states && radius == other.radius &&
+               include_centre == other.include_centre && birth_min == other.birth_min && birth_max == other.birth_max &&
+               survival_min == other.survival_min && survival_max == other.survival_max;
+    }
+};
+
+// dying states are stored below the alive bit of the state textures
+inline constexpr int max_states = 128;
+inline constexpr int max_radius = 10;
+
+struct NamedRule
+{
+    const char *name;
+    LifeRule rule;
+};
+
+// well-known rules, they get dedicated kernels on the cpu (see cpu_engine.cpp)
+inline constexpr NamedRule rule_presets[] = {
+    {"Life", {1 << 3, (1 << 2) | (1 << 3)}},
+    {"HighLife", {(1 << 3) | (1 << 6), (1 << 2) | (1 << 3)}},
+    {"Day & Night", {(1 << 3) | (1 << 6) | (1 << 7) | (1 << 8), (1 << 3) | (1 << 4) | (1 << 6) | (1 << 7) | (1 << 8)}},
+    {"Seeds", {1 << 2, 0}},
+    {"Life without death", {1 << 3, 0x1ff}},
+    {"2x2", {(1 << 3) | (1 << 6), (1 << 1) | (1 << 2) | (1 << 5)}},
+    {"Maze", {1 << 3, (1 << 1) | (1 << 2) | (1 << 3) | (1 << 4) | (1 << 5)}},
+    {"Replicator", {(1 << 1) | (1 << 3) | (1 << 5) | (1 << 7), (1 << 1) | (1 << 3) | (1 << 5) | (1 << 7)}},
+};
+
+// Generations and Larger than Life rules, run by the byte-per-cell engine on the cpu (see cell_engine.hpp)
+inline constexpr NamedRule extended_rule_presets[] = {
+    {"Brian's Brain", {1 << 2, 0, 3}},
+    {"Star Wars", {1 << 2, (1 << 3) | (1 << 4) | (1 << 5), 4}},
+    {"Bosco's rule", {0, 0, 2, 5, true, 34, 45, 34, 58}},
+    {"Majority", {0, 0, 2, 4, true, 41, 81, 41, 81}},
+};
+
+/**
+ * Parse a rule given either as B3/S23, as the older S/B notation 23/3 or as the name of a preset
+ * Generations rules add a number of states (B2/S/C3 or 345/2/4), Larger than Life rules use the
+ * R<radius>,C<states>,M<0|1>,S<min>..<max>,B<min>..<max>,NM notation
+ * Return false if the rule could not be parsed, rule is then left untouched
+ **/
+bool parseRule(std::string_view text, LifeRule &rule);
+
+/**
+ * Return the B/S notation of a rule, B/S/C for Generations rules and the R,C,M,S,B,N notation for Larger than Life
+ **/
+std::string ruleToString(const LifeRule &rule);
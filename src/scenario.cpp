@@ -0,0 +1,410 @@
+#include "scenario.hpp"
+
+#include <cctype>
+#include <cerrno>     // needed to tell numbers out of range
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>    // needed to parse numbers
+#include <filesystem> // needed to create the snapshot directory
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+
+namespace
+{
+    /**
+     * Read a whole decimal number from minimum to maximum, return false for anything else ("12k", "0x2a", "1e3")
+     **/
+    bool parseNumber(const std::string &text, long minimum, long maximum, long &value)
+    {
+        // strtol skips leading blanks
+        if (text.empty() || !(std::isdigit((unsigned char)text[0]) || text[0] == '-'))
+        {
+            return false;
+        }
+        char *end = nullptr;
+        errno = 0;
+        long parsed = std::strtol(text.c_str(), &end, 10);
+        if (*end != '\0' || errno == ERANGE || parsed < minimum || parsed > maximum)
+        {
+            return false;
+        }
+        value = parsed;
+        return true;
+    }
+
+    bool parseSeed(const std::string &text, uint64_t &seed)
+    {
+        // strtoull would take a minus sign and wrap the number around
+        if (text.empty() || !std::isdigit((unsigned char)text[0]))
+        {
+            return false;
+        }
+        char *end = nullptr;
+        errno = 0;
+        unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+        if (*end != '\0' || errno == ERANGE)
+        {
+            return false;
+        }
+        seed = parsed;
+        return true;
+    }
+
+    bool parseRate(const std::string &text, double &rate)
+    {
+        if (text.empty() || !std::isdigit((unsigned char)text[0]))
+        {
+            return false;
+        }
+        char *end = nullptr;
+        double parsed = std::strtod(text.c_str(), &end);
+        if (*end != '\0' || !std::isfinite(parsed))
+        {
+            return false;
+        }
+        rate = parsed;
+        return true;
+    }
+}
+
+bool readConfigFile(const std::string &path, std::vector<std::string> &arguments)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream words(line);
+        std::string word;
+        if (!(words >> word) || word[0] == '#')
+        {
+            continue;
+        }
+        arguments.push_back("--" + word);
+        while (words >> word)
+        {
+            arguments.push_back(word);
+        }
+    }
+    return true;
+}
+
+bool parseOptions(std::vector<std::string> arguments, Options &options)
+{
+    bool has_record_output = false;
+    // configuration files being read, with the index past their last option: a file given again before its own
+    // end includes itself, directly or through others, and would be expanded forever
+    std::vector<std::pair<std::filesystem::path, size_t>> configs;
+    for (size_t i = 0; i < arguments.size(); ++i)
+    {
+        while (!configs.empty() && configs.back().second <= i)
+        {
+            configs.pop_back();
+        }
+        std::string_view option = arguments[i];
+        // the option takes a value
+        bool valued = i + 1 < arguments.size();
+        if (option == "--help")
+        {
+            options.help = true;
+            return true;
+        }
+        else if (option == "--config" && valued)
+        {
+            std::error_code error;
+            std::filesystem::path path = std::filesystem::weakly_canonical(arguments[++i], error);
+            if (error)
+            {
+                path = arguments[i];
+            }
+            for (const auto &open : configs)
+            {
+                if (open.first == path)
+                {
+                    std::cout << "the configuration file " << arguments[i] << " includes itself" << std::endl;
+                    return false;
+                }
+            }
+            std::vector<std::string> config;
+            if (!readConfigFile(arguments[i], config))
+            {
+                std::cout << "could not read the configuration file " << arguments[i] << std::endl;
+                return false;
+            }
+            arguments.insert(arguments.begin() + i + 1, config.begin(), config.end());
+            // the files being read hold the options just inserted
+            for (auto &open : configs)
+            {
+                open.second += config.size();
+            }
+            configs.emplace_back(path, i + 1 + config.size());
+        }
+        else if (option == "--engine" && valued)
+        {
+            if (!parseEngineKind(arguments[++i].c_str(), options.engine_kind))
+            {
+                std::cout << "unknown engine " << arguments[i] << ", expected fragment, compute, cpu or lookup" << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--rule" && valued)
+        {
+            if (!parseRule(arguments[++i], options.rule))
+            {
+                std::cout << "could not parse the rule " << arguments[i] << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--seed" && valued)
+        {
+            if (!parseSeed(arguments[++i], options.seed))
+            {
+                std::cout << "could not parse the seed " << arguments[i] << ", expected a decimal number" << std::endl;
+                return false;
+            }
+            options.has_seed = true;
+            options.domain_settings.seed = options.seed;
+            options.soup_settings.seed = options.seed;
+            options.out_of_core_settings.seed = options.seed;
+        }
+        else if (option == "--pattern" && valued)
+        {
+            if (!readPatternFile(arguments[++i], options.pattern))
+            {
+                std::cout << "could not read a pattern from " << arguments[i] << std::endl;
+                return false;
+            }
+            options.has_pattern = true;
+        }
+        else if (option == "--on-cycle" && valued)
+        {
+            if (!parseCycleAction(arguments[++i].c_str(), options.cycle_action))
+            {
+                std::cout << "unknown cycle action " << arguments[i] << ", expected report, stop or fast-forward" << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--snapshot-every" && valued)
+        {
+            if (!parseNumber(arguments[++i], 0, LONG_MAX, options.snapshot_interval))
+            {
+                std::cout << "could not parse the snapshot interval " << arguments[i] << ", expected a whole number" << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--snapshot-prefix" && valued)
+        {
+            options.snapshot_prefix = arguments[++i];
+        }
+        else if (option == "--shader-dir" && valued)
+        {
+            options.shader_directory = arguments[++i];
+        }
+        else if (option == "--hash-log" && valued)
+        {
+            options.hash_log_path = arguments[++i];
+        }
+        else if (option == "--check-log" && valued)
+        {
+            options.check_log_path = arguments[++i];
+        }
+        else if (option == "--headless")
+        {
+            options.headless = true;
+        }
+        else if (option == "--soup-search")
+        {
+            options.soup_search = true;
+        }
+        else if (option == "--soups" && valued)
+        {
+            if (!parseNumber(arguments[++i], 0, LONG_MAX, options.soup_settings.soup_count))
+            {
+                std::cout << "could not parse the number of soups " << arguments[i] << ", expected a whole number" << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--domain" && valued)
+        {
+            long processes = 0;
+            if (!parseNumber(arguments[++i], 1, 1024, processes))
+            {
+                std::cout << "could not parse the number of processes " << arguments[i] << ", expected 1 to 1024" << std::endl;
+                return false;
+            }
+            options.domain = true;
+            options.domain_settings.processes = int(processes);
+        }
+        else if (option == "--halo" && valued)
+        {
+            long halo = 0;
+            if (!parseNumber(arguments[++i], 1, INT_MAX, halo))
+            {
+                std::cout << "could not parse the halo " << arguments[i] << ", expected a positive number of rows" << std::endl;
+                return false;
+            }
+            options.domain_settings.halo = int(halo);
+        }
+        else if (option == "--out-of-core" && valued)
+        {
+            options.out_of_core = true;
+            options.out_of_core_settings.path = arguments[++i];
+        }
+        else if (option == "--size" && valued)
+        {
+            long width = 0, height = 0;
+            // the whole value has to be read
+            int length = 0;
+            if (std::sscanf(arguments[++i].c_str(), "%ldx%ld%n", &width, &height, &length) != 2 || length != int(arguments[i].size()) ||
+                width <= 0 || height <= 0 || width > INT_MAX || height > INT_MAX)
+            {
+                std::cout << "could not parse the size " << arguments[i] << ", expected <width>x<height>" << std::endl;
+                return false;
+            }
+            options.domain_settings.width = int(width);
+            options.domain_settings.height = int(height);
+            options.out_of_core_settings.width = width;
+            options.out_of_core_settings.height = height;
+            options.width = int(width);
+            options.height = int(height);
+        }
+        else if (option == "--threads" && valued)
+        {
+            long threads = 0;
+            if (!parseNumber(arguments[++i], 0, 4096, threads))
+            {
+                std::cout << "could not parse the number of threads " << arguments[i] << ", expected 0 (one per cpu) to 4096" << std::endl;
+                return false;
+            }
+            options.threads = int(threads);
+            options.sparse_settings.threads = options.threads;
+        }
+        else if (option == "--benchmark")
+        {
+            options.benchmark = true;
+        }
+        else if (option == "--sparse")
+        {
+            options.sparse = true;
+        }
+        else if (option == "--topology")
+        {
+            options.topology = true;
+        }
+        else if (option == "--record-format" && valued)
+        {
+            if (!parseRecordFormat(arguments[++i].c_str(), options.record_settings.format))
+            {
+                std::cout << "unknown record format " << arguments[i] << ", expected png or y4m" << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--record-output" && valued)
+        {
+            options.record_settings.output = arguments[++i];
+            has_record_output = true;
+        }
+        else if (option == "--overlay")
+        {
+            options.overlay = true;
+        }
+        else if (option == "--swap" && valued)
+        {
+            if (!parseSwapMode(arguments[++i].c_str(), options.swap_mode))
+            {
+                std::cout << "unknown swap mode " << arguments[i] << ", expected off, on or adaptive" << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--target-fps" && valued)
+        {
+            if (!parseRate(arguments[++i], options.target_rate))
+            {
+                std::cout << "could not parse the target rate " << arguments[i] << ", expected frames per second, 0 for the monitor's" << std::endl;
+                return false;
+            }
+            options.paced = true;
+        }
+        else if (option == "--generations" && valued)
+        {
+            if (!parseNumber(arguments[++i], 0, LONG_MAX, options.generations))
+            {
+                std::cout << "could not parse the number of generations " << arguments[i] << ", expected a whole number" << std::endl;
+                return false;
+            }
+            options.has_generations = true;
+            options.domain_settings.generations = options.generations;
+            options.out_of_core_settings.generations = options.generations;
+            options.sparse_settings.generations = options.generations;
+        }
+        else
+        {
+            std::cout << "unknown option " << option << (valued ? "" : " or missing value") << ", see --help" << std::endl;
+            return false;
+        }
+    }
+    // the default output is a prefix of png files, a y4m recording is a single stream
+    if (options.record_settings.format == RecordFormat::Y4m && !has_record_output)
+    {
+        options.record_settings.output = "capture/recording.y4m";
+    }
+    return true;
+}
+
+void printUsage()
+{
+    std::cout << "usage: main [options]\n"
+                 "  --config <file>              read options from a file, one per line without the dashes\n"
+                 "  --engine fragment|compute|cpu|lookup\n"
+                 "  --size <width>x<height>      grid size, the window is scaled down to at most 1024 pixels\n"
+                 "  --rule <rule>                B3/S23, a Generations or Larger than Life rule, or a preset name\n"
+                 "  --seed <n>                   seed of the random grid, the same grid on every machine\n"
+                 "  --pattern <file>             start from a .rle or .cells pattern instead of a random grid\n"
+                 "  --generations <n>            pause at generation n, or length of the headless and benchmark runs\n"
+                 "  --on-cycle report|stop|fast-forward\n"
+                 "  --snapshot-every <n>         write every n-th generation as a pgm image\n"
+                 "  --snapshot-prefix <prefix>   snapshots go to <prefix>_<generation>.pgm\n"
+                 "  --shader-dir <directory>     where the shader sources are, src/shaders by default\n"
+                 "  --headless                   step without any window and exit at the last generation\n"
+                 "  --hash-log <file>            write the hash of every generation\n"
+                 "  --check-log <file>           compare the hash of every generation with an earlier log\n"
+                 "  --benchmark                  step the same grid on every engine and compare them\n"
+                 "  --threads <n>                workers of the cpu engines\n"
+                 "  --soup-search                search soups in universes tiling the grid, with --seed and --size\n"
+                 "  --soups <n>                  end the soup search after n soups, 0 to search forever\n"
+                 "  --record-format png|y4m      format of the recordings started with R\n"
+                 "  --record-output <output>     prefix of the png files, y4m file, or |command reading the y4m stream\n"
+                 "  --swap off|on|adaptive, --target-fps <rate>, --overlay\n"
+                 "  --domain <processes>, --halo <rows>, --out-of-core <file>, --sparse, --topology\n";
+}
+
+bool writeSnapshot(const std::string &prefix, long generation, const uint8_t *cells, int width, int height)
+{
+    std::filesystem::path directory = std::filesystem::path(prefix).parent_path();
+    if (!directory.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s_%08ld.pgm", prefix.c_str(), generation);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "P5\n%d %d\n255\n", width, height);
+    // the engines store the bottom row first
+    for (int y = height - 1; y >= 0; --y)
+    {
+        fwrite(cells + size_t(y) * width, 1, width, file);
+    }
+    return fclose(file) == 0;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cycle_detector.hpp"
+#include "domain.hpp"
+#include "frame_pacer.hpp"
+#include "life_engine.hpp"
+#include "out_of_core.hpp"
+#include "pattern.hpp"
+#include "recorder.hpp"
+#include "rule.hpp"
+#include "soup_search.hpp"
+#include "sparse_world.hpp"
+
+/**
+ * Everything the command line sets, the defaults are those of a run without any option
+ **/
+struct Options
+{
+    // --help was given, the other options were not read
+    bool help{false};
+
+    EngineKind engine_kind{EngineKind::GpuFragment};
+    LifeRule rule{rule_presets[0].rule};
+    // 0 until --size is given, the grid then has the size of the window
+    int width{0};
+    int height{0};
+    // 0 for one worker per cpu
+    int threads{0};
+
+    uint64_t seed{0};
+    bool has_seed{false};
+    Pattern pattern;
+    bool has_pattern{false};
+
+    long generations{0};
+    bool has_generations{false};
+    CycleAction cycle_action{CycleAction::Stop};
+
+    long snapshot_interval{0};
+    std::string snapshot_prefix{"snapshot/generation"};
+    std::string shader_directory{"src/shaders"};
+    // empty when not given
+    std::string hash_log_path;
+    std::string check_log_path;
+
+    SwapMode swap_mode{SwapMode::On};
+    bool paced{false};
+    // 0 for the refresh rate of the monitor
+    double target_rate{0.0};
+    bool overlay{false};
+    RecordSettings record_settings;
+
+    // the runs other than the interactive one, the last four with the settings of their own modules
+    bool headless{false};
+    bool benchmark{false};
+    bool topology{false};
+    bool soup_search{false};
+    // universes_x and universes_y are left to the one who applies the options, they follow from the size of the grid
+    SoupSearchSettings soup_settings;
+    bool domain{false};
+    DomainSettings domain_settings;
+    bool out_of_core{false};
+    OutOfCoreSettings out_of_core_settings;
+    bool sparse{false};
+    SparseSettings sparse_settings;
+};
+
+/**
+ * Read the command line arguments, the program name excluded, into options
+ * Later options override earlier ones, the options of a configuration file (see readConfigFile) are read in place of
+ * --config <file>
+ * Return false, after telling why, if an option is unknown, misses its value or has an invalid one
+ **/
+bool parseOptions(std::vector<std::string> arguments, Options &options);
+
+/**
+ * Print the options, as given on the command line or in a configuration file (see readConfigFile)
+ **/
+void printUsage();
+
+/**
+ * Append the options of a configuration file to arguments, as if they had been given on the command line
+ * Every line holds an option without its leading dashes and its values, "size 2048x2048" stands for --size 2048x2048.
+ * Blank lines and lines starting with '#' are skipped
+ * Return false if the file could not be read
+ **/
+bool readConfigFile(const std::string &path, std::vector<std::string> &arguments);
+
+/**
+ * Write a grid, one byte per cell as stored by the engines, to <prefix>_<generation>.pgm
+ * The grey levels are the cell bytes, top row first, so any image viewer shows it the way the window does
+ * Return false if the file could not be written
+ **/
+bool writeSnapshot(const std::string &prefix, long generation, const uint8_t *cells, int width, int height);
@@ -0,0 +1,435 @@
+#include "shader.hpp"
+
+#include <glad/glad.h> // needed to handle opengl function pointers
+#include <cstdio>
+#include <filesystem> // needed to create the cache directory
+#include <fstream>    // needed to read shaders from file
+#include <iostream>   // needed for std::cout
+#include <sstream>    // needed to simply get strings from files
+
+#include "gl_extensions.hpp"
+
+namespace
+{
+    const uint32_t binary_magic = 0x424c4f47; // "GOLB"
+
+    // 64 bits FNV-1a, good enough to tell shader variants apart
+    uint64_t hashBytes(const std::string &bytes, uint64_t hash = 0xcbf29ce484222325ull)
+    {
+        for (unsigned char c : bytes)
+        {
+            hash = (hash ^ c) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    std::string glString(GLenum name)
+    {
+        const GLubyte *value = glGetString(name);
+        return value != NULL ? reinterpret_cast<const char *>(value) : "";
+    }
+
+    unsigned int submitShader(GLenum type, const std::string &source)
+    {
+        const char *source_pointer = source.c_str();
+        unsigned int shader_id = glCreateShader(type);
+        glShaderSource(shader_id, 1, &source_pointer, NULL);
+        glCompileShader(shader_id);
+        return shader_id;
+    }
+
+    /**
+     * Print the compilation log of a shader and return false if it failed to compile
+     **/
+    bool checkShader(unsigned int shader_id, const std::string &path)
+    {
+        int success;
+        glGetShaderiv(shader_id, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[512];
+            glGetShaderInfoLog(shader_id, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::COMPILATION_FAILED " << path << "\n"
+                      << infoLog << std::endl;
+        }
+        return success;
+    }
+}
+
+bool tryGetShaderContent(const char *path, std::string &content)
+{
+
+    std::ifstream shaderFile(path);
+    if (!shaderFile.is_open())
+    {
+        std::cout << "could not open shader at " << path << std::endl;
+        return false;
+    }
+    std::stringstream shaderStrStream;
+    shaderStrStream << shaderFile.rdbuf();
+    shaderFile.close();
+
+    content = shaderStrStream.str();
+    return true;
+}
+
+std::string injectDefines(const std::string &source, const ShaderDefines &defines)
+{
+    if (defines.empty())
+    {
+        return source;
+    }
+
+    std::string block;
+    for (const auto &[name, value] : defines)
+    {
+        block += "#define " + name + " " + value + "\n";
+    }
+
+    // #version has to stay the first statement, #line keeps compiler messages pointing at the right lines
+    size_t version = source.find("#version");
+    if (version == std::string::npos)
+    {
+        return block + "#line 1\n" + source;
+    }
+    size_t line_end = source.find('\n', version);
+    if (line_end == std::string::npos)
+    {
+        return source + "\n" + block;
+    }
+    return source.substr(0, line_end + 1) + block + "#line 2\n" + source.substr(line_end + 1);
+}
+
+ShaderCache::ShaderCache(std::string shader_directory, std::string directory)
+    : shader_directory(std::move(shader_directory)), directory(std::move(directory))
+{
+    // a binary is only valid for the exact driver that produced it
+    driver_hash = hashBytes(glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION) + "|" + glString(GL_SHADING_LANGUAGE_VERSION));
+
+    if (glext::program_binary)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(this->directory, error);
+    }
+}
+
+uint64_t ShaderCache::requestProgram(const char *vertex_file, const char *fragment_file, const ShaderDefines &defines)
+{
+    std::string vertex_path = shader_directory + "/" + vertex_file;
+    std::string fragment_path = shader_directory + "/" + fragment_file;
+    PendingProgram pending;
+    std::string vertex_source, fragment_source;
+    if (!tryGetShaderContent(vertex_path.c_str(), vertex_source) || !tryGetShaderContent(fragment_path.c_str(), fragment_source))
+    {
+        return 0;
+    }
+    pending.stages.push_back({GL_VERTEX_SHADER, 0, vertex_path, injectDefines(vertex_source, defines)});
+    pending.stages.push_back({GL_FRAGMENT_SHADER, 0, fragment_path, injectDefines(fragment_source, defines)});
+    return submitProgram(std::move(pending));
+}
+
+uint64_t ShaderCache::requestComputeProgram(const char *compute_file, const ShaderDefines &defines)
+{
+    std::string compute_path = shader_directory + "/" + compute_file;
+    PendingProgram pending;
+    std::string compute_source;
+    if (!tryGetShaderContent(compute_path.c_str(), compute_source))
+    {
+        return 0;
+    }
+    pending.stages.push_back({GL_COMPUTE_SHADER, 0, compute_path, injectDefines(compute_source, defines)});
+    return submitProgram(std::move(pending));
+}
+
+/**
+ * Return the key of a variant, submitting its build unless it is already built or pending
+ **/
+uint64_t ShaderCache::submitProgram(PendingProgram pending)
+{
+    uint64_t key = driver_hash;
+    for (const PendingStage &stage : pending.stages)
+    {
+        key = hashBytes(stage.source, key * 31 + stage.type);
+    }
+    if (programs.count(key) != 0 || pending_programs.count(key) != 0)
+    {
+        return key;
+    }
+
+    char file_name[32];
+    snprintf(file_name, sizeof(file_name), "%016llx.bin", static_cast<unsigned long long>(key));
+    pending.binary_path = directory + "/" + file_name;
+
+    pending.program_id = glext::program_binary ? submitBinary(pending.binary_path) : 0;
+    pending.from_binary = pending.program_id != 0;
+    if (!pending.from_binary)
+    {
+        submitCompilation(pending);
+    }
+    pending_programs[key] = std::move(pending);
+    return key;
+}
+
+bool ShaderCache::isProgramReady(uint64_t key)
+{
+    auto pending = pending_programs.find(key);
+    if (pending == pending_programs.end() || !glext::parallel_shader_compile)
+    {
+        return true;
+    }
+    int completed = GL_TRUE;
+    glGetProgramiv(pending->second.program_id, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+unsigned int ShaderCache::finishProgram(uint64_t key)
+{
+    unsigned int program_id = buildProgram(key);
+    if (program_id != 0)
+    {
+        pinned_programs.insert(key);
+    }
+    return program_id;
+}
+
+unsigned int ShaderCache::acquireProgram(uint64_t key)
+{
+    unsigned int program_id = buildProgram(key);
+    if (program_id != 0)
+    {
+        slot_users[key]++;
+    }
+    return program_id;
+}
+
+void ShaderCache::releaseProgram(uint64_t key)
+{
+    auto users = slot_users.find(key);
+    if (users == slot_users.end() || --users->second > 0)
+    {
+        return;
+    }
+    slot_users.erase(users);
+    auto built = programs.find(key);
+    if (built != programs.end() && pinned_programs.count(key) == 0)
+    {
+        // a hot reload or a rule change replaced it, requesting it again reloads its binary from the disk cache
+        glDeleteProgram(built->second);
+        programs.erase(built);
+    }
+}
+
+unsigned int ShaderCache::buildProgram(uint64_t key)
+{
+    auto built = programs.find(key);
+    if (built != programs.end())
+    {
+        return built->second;
+    }
+    auto pending = pending_programs.find(key);
+    if (pending == pending_programs.end())
+    {
+        return 0;
+    }
+
+    unsigned int program_id = 0;
+    if (pending->second.from_binary)
+    {
+        int success;
+        glGetProgramiv(pending->second.program_id, GL_LINK_STATUS, &success);
+        if (success)
+        {
+            program_id = pending->second.program_id;
+            loaded_count++;
+        }
+        else
+        {
+            // drivers may refuse binaries even for the same version, in which case the source path takes over
+            glDeleteProgram(pending->second.program_id);
+            submitCompilation(pending->second);
+        }
+    }
+    if (program_id == 0 && pending->second.program_id != 0)
+    {
+        program_id = completeCompilation(pending->second);
+    }
+
+    // failures are not kept, a later request of the same variant tries again
+    if (program_id != 0)
+    {
+        programs[key] = program_id;
+    }
+    pending_programs.erase(pending);
+    return program_id;
+}
+
+unsigned int ShaderCache::getProgram(const char *vertex_file, const char *fragment_file, const ShaderDefines &defines)
+{
+    return finishProgram(requestProgram(vertex_file, fragment_file, defines));
+}
+
+void ShaderCache::deletePrograms()
+{
+    for (const auto &[key, program_id] : programs)
+    {
+        glDeleteProgram(program_id);
+    }
+    programs.clear();
+    slot_users.clear();
+    pinned_programs.clear();
+
+    for (const auto &[key, pending] : pending_programs)
+    {
+        for (const PendingStage &stage : pending.stages)
+        {
+            glDeleteShader(stage.shader_id);
+        }
+        glDeleteProgram(pending.program_id);
+    }
+    pending_programs.clear();
+}
+
+/**
+ * Submit the compilation of every shader and the link of the program, none of these calls wait for the driver
+ **/
+void ShaderCache::submitCompilation(PendingProgram &pending)
+{
+    pending.from_binary = false;
+    pending.program_id = glCreateProgram();
+    if (glext::program_binary)
+    {
+        glext::programParameteri(pending.program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    for (PendingStage &stage : pending.stages)
+    {
+        stage.shader_id = submitShader(stage.type, stage.source);
+        glAttachShader(pending.program_id, stage.shader_id);
+    }
+    glLinkProgram(pending.program_id);
+}
+
+/**
+ * Check a submitted compilation, print logs on failure and store the binary on success
+ **/
+unsigned int ShaderCache::completeCompilation(PendingProgram &pending)
+{
+    bool compiled = true;
+    for (const PendingStage &stage : pending.stages)
+    {
+        compiled = checkShader(stage.shader_id, stage.path) && compiled;
+        // once they are linked into the shader program, we can get rid of initial shaders
+        glDeleteShader(stage.shader_id);
+    }
+
+    int success = 0;
+    if (compiled)
+    {
+        glGetProgramiv(pending.program_id, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[512];
+            glGetProgramInfoLog(pending.program_id, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED " << pending.stages.back().path << "\n"
+                      << infoLog << std::endl;
+        }
+    }
+    if (!success)
+    {
+        glDeleteProgram(pending.program_id);
+        return 0;
+    }
+
+    compiled_count++;
+    if (glext::program_binary)
+    {
+        saveBinary(pending.program_id, pending.binary_path);
+    }
+    return pending.program_id;
+}
+
+/**
+ * Return a program loading a cached binary, 0 if there is none
+ * Whether the driver accepted it is only checked in finishProgram
+ **/
+unsigned int ShaderCache::submitBinary(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return 0;
+    }
+
+    uint32_t magic = 0, format = 0;
+    file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char *>(&format), sizeof(format));
+    std::string binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (magic != binary_magic || binary.empty())
+    {
+        return 0;
+    }
+
+    unsigned int program_id = glCreateProgram();
+    glext::programBinary(program_id, format, binary.data(), binary.size());
+    return program_id;
+}
+
+void ShaderCache::saveBinary(unsigned int program, const std::string &path)
+{
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    std::string binary(length, '\0');
+    GLenum format = 0;
+    glext::getProgramBinary(program, length, NULL, &format, binary.data());
+
+    // written under a temporary name first so that a concurrent run never reads a partial file
+    std::string temporary_path = path + ".tmp";
+    std::ofstream file(temporary_path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return;
+    }
+    uint32_t format_value = format;
+    file.write(reinterpret_cast<const char *>(&binary_magic), sizeof(binary_magic));
+    file.write(reinterpret_cast<const char *>(&format_value), sizeof(format_value));
+    file.write(binary.data(), binary.size());
+    file.close();
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+}
+
+bool ProgramSlot::update(bool wait)
+{
+    if (pending_key == 0 || (!wait && !shader_cache.isProgramReady(pending_key)))
+    {
+        return false;
+    }
+    uint64_t new_program_key = pending_key;
+    unsigned int new_program_id = shader_cache.acquireProgram(new_program_key);
+    pending_key = 0;
+    if (new_program_id == 0)
+    {
+        std::cout << "keeping the previous program" << std::endl;
+        return false;
+    }
+    if (program_key != 0)
+    {
+        shader_cache.releaseProgram(program_key);
+    }
+    program_id = new_program_id;
+    program_key = new_program_key;
+    return true;
+}
+
+ProgramSlot::~ProgramSlot()
+{
+    if (program_key != 0)
+    {
+        shader_cache.releaseProgram(program_key);
+    }
+}
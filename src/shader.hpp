@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// list of "#define name value" injected right after the #version line of a shader
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * Read the content of a shader file, return false if no shader file found
+ **/
+bool tryGetShaderContent(const char *path, std::string &content);
+
+/**
+ * Return the source with the defines inserted after its #version line
+ **/
+std::string injectDefines(const std::string &source, const ShaderDefines &defines);
+
+/**
+ * Build shader programs once per variant (sources + defines) and keep them in memory and on disk
+ * Linked programs are saved with glGetProgramBinary under a key made of the driver identity and of the hash of the
+ * final sources, so the next run skips compilation. A binary rejected by the driver is simply recompiled
+ *
+ * Building is split in two: requestProgram only submits the compile and link commands, finishProgram checks their
+ * status. Requesting every program first lets the driver compile them in parallel (GL_KHR_parallel_shader_compile)
+ * while the application keeps working, instead of waiting on each status query in turn
+ **/
+class ShaderCache
+{
+public:
+    /**
+     * Sources are read from shader_directory, binaries are saved to directory
+     **/
+    explicit ShaderCache(std::string shader_directory = "src/shaders", std::string directory = ".shader_cache");
+
+    /**
+     * Submit the build of this variant without waiting for it, return the key identifying the variant
+     * or 0 if a source file could not be read. Files are named relative to the shader directory
+     **/
+    uint64_t requestProgram(const char *vertex_file, const char *fragment_file, const ShaderDefines &defines = {});
+
+    /**
+     * Same as requestProgram for a compute shader, only valid if glext::compute_shader is set
+     **/
+    uint64_t requestComputeProgram(const char *compute_file, const ShaderDefines &defines = {});
+
+    /**
+     * Return true if finishProgram would not block, always true without parallel compilation
+     **/
+    bool isProgramReady(uint64_t key);
+
+    /**
+     * Wait for a requested variant, return its linked program or 0 if it failed to build
+     * The program is kept until deletePrograms. A failed variant is forgotten, requesting it again builds it again
+     **/
+    unsigned int finishProgram(uint64_t key);
+
+    /**
+     * Same as finishProgram for a program slot, the program is deleted once every slot that acquired it released it
+     **/
+    unsigned int acquireProgram(uint64_t key);
+    void releaseProgram(uint64_t key);
+
+    /**
+     * Request and finish a variant at once
+     **/
+    unsigned int getProgram(const char *vertex_file, const char *fragment_file, const ShaderDefines &defines = {});
+
+    int compiledCount() const { return compiled_count; }
+    int loadedCount() const { return loaded_count; }
+
+    /**
+     * Delete every program, must be called while the context is still alive
+     **/
+    void deletePrograms();
+
+private:
+    struct PendingStage
+    {
+        unsigned int type{0};
+        unsigned int shader_id{0};
+        std::string path;
+        std::string source;
+    };
+    struct PendingProgram
+    {
+        unsigned int program_id{0};
+        bool from_binary{false};
+        std::vector<PendingStage> stages;
+        std::string binary_path;
+    };
+
+    unsigned int buildProgram(uint64_t key);
+    uint64_t submitProgram(PendingProgram pending);
+    void submitCompilation(PendingProgram &pending);
+    unsigned int completeCompilation(PendingProgram &pending);
+    unsigned int submitBinary(const std::string &path);
+    void saveBinary(unsigned int program, const std::string &path);
+
+    std::string shader_directory;
+    std::string directory;
+    uint64_t driver_hash{0};
+    // built programs, and how many slots use each of those acquired by slots
+    std::unordered_map<uint64_t, unsigned int> programs;
+    std::unordered_map<uint64_t, int> slot_users;
+    // programs finished outside of slots, never deleted before deletePrograms
+    std::unordered_set<uint64_t> pinned_programs;
+    std::unordered_map<uint64_t, PendingProgram> pending_programs;
+    int compiled_count{0};
+    int loaded_count{0};
+};
+
+/**
+ * Program in use by a pass, replaced by a newly requested variant once it is built
+ * The current program keeps running while the new variant builds, and stays in use if it fails to build
+ **/
+class ProgramSlot
+{
+public:
+    explicit ProgramSlot(ShaderCache &shader_cache) : shader_cache(shader_cache) {}
+    ~ProgramSlot();
+
+    ProgramSlot(const ProgramSlot &) = delete;
+    ProgramSlot &operator=(const ProgramSlot &) = delete;
+
+    void request(uint64_t key) { pending_key = key; }
+
+    /**
+     * Swap the pending variant in if it is built, waiting for it if wait is set
+     * Return true if a new program is now in use
+     **/
+    bool update(bool wait = false);
+
+    unsigned int id() const { return program_id; }
+    bool isPending() const { return pending_key != 0; }
+
+private:
+    ShaderCache &shader_cache;
+    unsigned int program_id{0};
+    uint64_t program_key{0};
+    uint64_t pending_key{0};
+};
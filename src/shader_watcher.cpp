@@ -0,0 +1,66 @@
+#include "shader_watcher.hpp"
+
+#include <iostream> // needed for std::cout
+
+#ifdef __linux__
+#include <sys/inotify.h> // needed to be notified of file changes
+#include <unistd.h>
+#endif
+
+ShaderWatcher::ShaderWatcher(const std::string &directory)
+{
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+    {
+        std::cout << "could not watch shaders, hot reload disabled" << std::endl;
+        return;
+    }
+    if (inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        std::cout << "could not watch " << directory << ", hot reload disabled" << std::endl;
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+    if (inotify_fd >= 0)
+    {
+        close(inotify_fd);
+    }
+#endif
+}
+
+bool ShaderWatcher::poll()
+{
+    bool changed = false;
+#ifdef __linux__
+    if (inotify_fd < 0)
+    {
+        return false;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    // draining every pending event, a single save usually produces several of them
+    while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char *pointer = buffer; pointer < buffer + length;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(pointer);
+            std::string name = event->len > 0 ? event->name : "";
+            if (name.size() > 5 && name.compare(name.size() - 5, 5, ".glsl") == 0)
+            {
+                std::cout << "shader changed: " << name << std::endl;
+                changed = true;
+            }
+            pointer += sizeof(inotify_event) + event->len;
+        }
+    }
+#endif
+    return changed;
+}
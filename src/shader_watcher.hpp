@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Watch a shader directory for modified files, with inotify on linux
+ * Editors often save by writing a temporary file and renaming it, so both writes and renames are reported
+ * On other platforms, or if inotify is unavailable, no change is ever reported
+ **/
+class ShaderWatcher
+{
+public:
+    explicit ShaderWatcher(const std::string &directory);
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher &) = delete;
+    ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+    /**
+     * Return true if a .glsl file changed since the last call, never blocks
+     **/
+    bool poll();
+
+private:
+    int inotify_fd{-1};
+};
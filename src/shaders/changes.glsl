@@ -0,0 +1,57 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D previous_state;
+uniform sampler2D current_state;
+// output of this pass for the previous generation
+uniform sampler2D previous_changes;
+uniform ivec2 tile_grid;
+uniform ivec2 grid_size;
+
+// same tile side as tile_vertex.glsl
+#ifndef TILE_SIZE
+#define TILE_SIZE 32
+#endif
+uniform bool all_active;
+
+// same test as tile_vertex.glsl
+bool isActive(ivec2 tile)
+{
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            ivec2 neighbour = (tile + ivec2(dx, dy) + tile_grid) % tile_grid;
+            if (texelFetch(previous_changes, neighbour, 0).r > 0.5)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+  One texel per tile, set if a cell of the tile changed during the last step
+  Tiles that were not stepped did not change, the others are compared until the first difference
+*/
+void main()
+{
+    ivec2 tile = ivec2(gl_FragCoord.xy);
+    bool changed = false;
+    if (all_active || isActive(tile))
+    {
+        ivec2 origin = tile * TILE_SIZE;
+        ivec2 end = min(origin + TILE_SIZE, grid_size);
+        for (int y = origin.y; y < end.y && !changed; ++y)
+        {
+            for (int x = origin.x; x < end.x && !changed; ++x)
+            {
+                changed = texelFetch(previous_state, ivec2(x, y), 0).r != texelFetch(current_state, ivec2(x, y), 0).r;
+            }
+        }
+    }
+    FragColor = vec4(changed ? 1.0 : 0.0, 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,63 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+uniform sampler2D source_texture;
+layout (r8) uniform writeonly image2D destination_image;
+uniform ivec2 grid_size;
+
+// same rule encoding as fragment.glsl, always baked into the variant
+const uint birth_mask = BIRTH_MASK;
+const uint survival_mask = SURVIVAL_MASK;
+
+// texels of the work group and of the ring of cells around it, each texel is fetched once per group instead of
+// 9 times per cell
+const int tile_width = 16 + 2;
+shared float tile[tile_width * tile_width];
+
+float texelAt(ivec2 local)
+{
+    return tile[(local.y + 1) * tile_width + local.x + 1];
+}
+#define CELL(dx, dy) int(texelAt(local + ivec2(dx, dy)) > 0.5)
+
+/**
+  Same generation as fragment.glsl, one invocation per cell
+*/
+void main()
+{
+    ivec2 group_origin = ivec2(gl_WorkGroupID.xy) * 16 - 1;
+    for (int i = int(gl_LocalInvocationIndex); i < tile_width * tile_width; i += 16 * 16)
+    {
+        // the grid is a torus
+        ivec2 cell = (group_origin + ivec2(i % tile_width, i / tile_width) + grid_size) % grid_size;
+        tile[i] = texelFetch(source_texture, cell, 0).r;
+    }
+    barrier();
+
+    ivec2 cell = ivec2(gl_GlobalInvocationID.xy);
+    if (cell.x >= grid_size.x || cell.y >= grid_size.y)
+    {
+        return;
+    }
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+
+    float self_texel = texelAt(local);
+    float self = float(self_texel > 0.5);
+    int nb_neighbour = CELL(-1, 1) + CELL(0, 1) + CELL(1, 1) +
+                       CELL(-1, 0) +              CELL(1, 0) +
+                       CELL(-1, -1) + CELL(0, -1) + CELL(1, -1);
+
+    uint rule_mask = self > 0.5 ? survival_mask : birth_mask;
+    float alive = float((rule_mask >> uint(nb_neighbour)) & 1u);
+#if defined(STATES)
+    int texel = int(self_texel * 255.0 + 0.5);
+    int next = self > 0.5 ? (alive > 0.5 ? 255 : STATES - 2) : (texel > 0 ? texel - 1 : int(alive) * 255);
+    imageStore(destination_image, cell, vec4(float(next) / 255.0, 0, 0, 1));
+#elif defined(TRACK_AGE)
+    int age = 127 - (int(self_texel * 255.0 + 0.5) & 127);
+    age = alive == self ? min(age + 1, 127) : 0;
+    imageStore(destination_image, cell, vec4(float(int(alive) * 128 + 127 - age) / 255.0, 0, 0, 1));
+#else
+    imageStore(destination_image, cell, vec4(alive, 0, 0, 1));
+#endif
+}
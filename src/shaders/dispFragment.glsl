@@ -2,10 +2,17 @@
 out vec4 FragColor;
   
 in vec2 TexCoord;
+#ifdef PACKED
+// bit-packed state (see StateTextures): 64 cells per texel, cell x of a row is bit x % 64 of texel x / 64
+uniform usampler2D previous_texture;
+uniform usampler2D current_texture;
+uniform ivec2 grid_size;
+#else
 // texture of previous iteration
 uniform sampler2D previous_texture;
 // texture of current iteration
 uniform sampler2D current_texture;
+#endif
 
 // this shader is supposed to only display current_texture to the screen
 // because current_texture is a Red-only texture, we only use the red coordinate
@@ -14,7 +21,43 @@ uniform sampler2D current_texture;
 // in order to better highlight active parts of the screen, we will display with a brighter color nely created cells
 
 void main()
-{   
+{
+#if defined(PACKED)
+  ivec2 cell = min(ivec2(TexCoord * vec2(grid_size)), grid_size - 1);
+  ivec2 texel = ivec2(cell.x / 64, cell.y);
+  // bits 0 to 31 of the word in red, 32 to 63 in green
+  int channel = (cell.x % 64) / 32;
+  uint current_word = texelFetch(current_texture, texel, 0)[channel];
+  uint previous_word = texelFetch(previous_texture, texel, 0)[channel];
+  // same colors as below, the 32 cells of a word are compared at once: born cells are alive and changed
+  uint born = current_word & (current_word ^ previous_word);
+  uint mask = 1u << uint(cell.x % 32);
+  float alive = float((current_word & mask) != 0u);
+  float dark_coefficient = (born & mask) != 0u ? 1.0 : 0.3;
+  FragColor = vec4(vec3(0.0, 1.0, 1.0) * alive * dark_coefficient, 1.0);
+#elif defined(TRACK_AGE)
+  // the age of the cell is stored in the same texel as its state (see fragment.glsl), a single fetch is enough
+  int texel = int(texture(current_texture, TexCoord).r * 255.0 + 0.5);
+  float age = float(127 - (texel & 127));
+  if (texel >= 128) {
+    // newborn cells are bright, and cool down to the usual dark cyan as they get older
+    FragColor = vec4(mix(vec3(1.0, 1.0, 0.7), vec3(0.0, 0.3, 0.3), sqrt(age / 127.0)), 1.0);
+  } else {
+    // dead cells leave a fading trail behind moving objects
+    float trail = max(0.0, 1.0 - age / 24.0);
+    FragColor = vec4(vec3(0.7, 0.1, 0.3) * trail, 1.0);
+  }
+#elif defined(STATES)
+  // Generations rules: alive cells as usual, dying cells fade out with the generations they have left
+  int texel = int(texture(current_texture, TexCoord).r * 255.0 + 0.5);
+  if (texel >= 128) {
+    bool newborn = texture(previous_texture, TexCoord).r < 0.5;
+    FragColor = vec4(vec3(0.0, 1.0, 1.0) * (newborn ? 1.0 : 0.6), 1.0);
+  } else {
+    float left = float(texel) / max(float(STATES - 2), 1.0);
+    FragColor = vec4(vec3(0.8, 0.3, 0.1) * left, 1.0);
+  }
+#else
   float previous_texture_color_red  = float(texture(previous_texture, TexCoord).r);
   float current_texture_color_red   = float(texture(current_texture, TexCoord).r);
 
@@ -29,4 +72,5 @@ void main()
   } else {
     FragColor = vec4(base_color * dark_coefficient, 1.0);
   }
-}
\ No newline at end of file
+#endif
+}
@@ -0,0 +1,18 @@
+#version 330 core
+out vec4 FragColor;
+
+// Keep (0), Dead (1) or Alive (2) for every cell of the edited box, see cell_edits.hpp
+uniform usampler2D edits_texture;
+// cell of the grid at the bottom left corner of the box
+uniform ivec2 box_origin;
+
+// drawn over the edited box of the current generation only, cells left as they are keep their texel
+void main()
+{
+  uint edit = texelFetch(edits_texture, ivec2(gl_FragCoord.xy) - box_origin, 0).r;
+  if (edit == 0u)
+  {
+    discard;
+  }
+  FragColor = vec4(edit == 2u ? 1.0 : 0.0);
+}
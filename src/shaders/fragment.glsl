@@ -5,6 +5,35 @@ in vec2 TexCoord;
 
 uniform sampler2D source_texture;
 
+// outer totalistic rule: bit n is set if a cell with n alive neighbours is alive at the next iteration
+// the rule is either baked into the shader variant, or passed as uniforms when compiled without defines
+#ifdef BIRTH_MASK
+const uint birth_mask = BIRTH_MASK;
+const uint survival_mask = SURVIVAL_MASK;
+#else
+uniform uint birth_mask;
+uniform uint survival_mask;
+#endif
+
+
+#ifdef UNIVERSE_SIZE
+// batched variant: the texture is an atlas of independent UNIVERSE_SIZE x UNIVERSE_SIZE tori,
+// neighbours wrap around the borders of their own universe instead of the whole texture
+ivec2 universe_origin = ivec2(gl_FragCoord.xy) / UNIVERSE_SIZE * UNIVERSE_SIZE;
+ivec2 local_cell = ivec2(gl_FragCoord.xy) - universe_origin;
+
+float texelAt(int dx, int dy)
+{
+    ivec2 local = (local_cell + ivec2(dx, dy) + UNIVERSE_SIZE) % UNIVERSE_SIZE;
+    return texelFetch(source_texture, universe_origin + local, 0).r;
+}
+#define TEXEL(dx, dy) texelAt(dx, dy)
+#else
+// the texture repeats, so the whole grid is a torus
+#define TEXEL(dx, dy) textureOffset(source_texture, TexCoord, ivec2(dx, dy)).r
+#endif
+// the state is the high bit of the texel, the low bits may hold the age of the cell
+#define CELL(dx, dy) int(TEXEL(dx, dy) > 0.5)
 
 /**
   This shader is supposed to create the game of life iteration from a sourceTexture
@@ -13,22 +42,23 @@ uniform sampler2D source_texture;
 void main()
 {
 
-    float self = texture(source_texture, TexCoord).r;
+    float self_texel = TEXEL(0, 0);
+    float self = float(self_texel > 0.5);
 
     //fetch each neighbor texel and current texel.
     //top row
-    int r00 = int(textureOffset(source_texture, TexCoord, ivec2(-1, 1)).r);
-    int r01 = int(textureOffset(source_texture, TexCoord, ivec2( 0, 1)).r);
-    int r02 = int(textureOffset(source_texture, TexCoord, ivec2( 1, 1)).r);
+    int r00 = CELL(-1, 1);
+    int r01 = CELL( 0, 1);
+    int r02 = CELL( 1, 1);
  
     //middle row
-    int r10 = int(textureOffset(source_texture, TexCoord, ivec2(-1, 0)).r);
-    int r12 = int(textureOffset(source_texture, TexCoord, ivec2( 1, 0)).r);
+    int r10 = CELL(-1, 0);
+    int r12 = CELL( 1, 0);
    
     //bottom row
-    int r20 = int(textureOffset(source_texture, TexCoord, ivec2(-1,-1)).r);
-    int r21 = int(textureOffset(source_texture, TexCoord, ivec2( 0,-1)).r);
-    int r22 = int(textureOffset(source_texture, TexCoord, ivec2( 1,-1)).r);
+    int r20 = CELL(-1,-1);
+    int r21 = CELL( 0,-1);
+    int r22 = CELL( 1,-1);
  
     int nb_neighbour =  (r00 + r01 + r02 +
                         r10       + r12 +
@@ -36,12 +66,22 @@ void main()
  
 
 
-    // staying alive
-    if (self == 1 && (nb_neighbour == 2 || nb_neighbour == 3 )) {
-      FragColor = vec4(1, 0, 0, 1);
-    } else if (self == 0 && nb_neighbour == 3) {
-      FragColor = vec4(1, 0, 0, 1);
-    } else {
-      FragColor = vec4(0, 0, 0, 1 );
-    }
+    // a single lookup in the mask of the current state replaces per-rule branches
+    uint rule_mask = self > 0.5 ? survival_mask : birth_mask;
+    float alive = float((rule_mask >> uint(nb_neighbour)) & 1u);
+#if defined(STATES)
+    // Generations rules: alive cells that do not survive start dying, the texels below the alive bit count the
+    // generations left before the cell is dead (see rule.hpp). Dying cells can not be born
+    int texel = int(self_texel * 255.0 + 0.5);
+    int next = self > 0.5 ? (alive > 0.5 ? 255 : STATES - 2) : (texel > 0 ? texel - 1 : int(alive) * 255);
+    FragColor = vec4(float(next) / 255.0, 0, 0, 1);
+#elif defined(TRACK_AGE)
+    // bit 7 is the state, bits 0 to 6 hold 127 - age, the age being the number of generations since the state last
+    // changed (saturating). Plain 0 and 255 texels read as cells dead for long and newborn cells
+    int age = 127 - (int(self_texel * 255.0 + 0.5) & 127);
+    age = alive == self ? min(age + 1, 127) : 0;
+    FragColor = vec4(float(int(alive) * 128 + 127 - age) / 255.0, 0, 0, 1);
+#else
+    FragColor = vec4(alive, 0, 0, 1);
+#endif
 }
\ No newline at end of file
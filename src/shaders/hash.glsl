@@ -0,0 +1,49 @@
+#version 330 core
+out uvec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D state_texture;
+uniform ivec2 grid_size;
+
+// side of the cell block summed by each output texel, one whole universe in batched runs
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 16
+#endif
+
+// same cell hash as state_hash.hpp, both sides must stay in sync
+uint mixHash(uint h)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+  Each output texel sums the hashes of the alive cells of a block, and counts them
+  x and y are two independent 32 bits lanes of the hash, z is the population
+*/
+void main()
+{
+    ivec2 origin = ivec2(gl_FragCoord.xy) * BLOCK_SIZE;
+    uvec4 sum = uvec4(0u);
+
+    for (int y = 0; y < BLOCK_SIZE; ++y)
+    {
+        for (int x = 0; x < BLOCK_SIZE; ++x)
+        {
+            ivec2 cell = origin + ivec2(x, y);
+            if (cell.x < grid_size.x && cell.y < grid_size.y && texelFetch(state_texture, cell, 0).r > 0.5)
+            {
+                uvec2 position = uvec2(cell);
+                sum.x += mixHash(position.x ^ mixHash(position.y ^ 0x9e3779b9u));
+                sum.y += mixHash(position.x ^ mixHash(position.y ^ 0x85ebca6bu));
+                sum.z += 1u;
+            }
+        }
+    }
+    FragColor = sum;
+}
@@ -0,0 +1,104 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D source_texture;
+// inclusive prefix sums of the alive cells, see prefix_sum.glsl
+uniform usampler2D summed_area;
+uniform ivec2 grid_size;
+
+// Larger than Life rule, baked into the shader variant: RADIUS, BIRTH_MIN, BIRTH_MAX, SURVIVAL_MIN, SURVIVAL_MAX,
+// STATES, and INCLUDE_CENTRE when the cell counts itself
+
+// alive cells in the rectangle from (0, 0) to cell, nothing before the first row or column
+int prefixSum(ivec2 cell)
+{
+    if (cell.x < 0 || cell.y < 0)
+    {
+        return 0;
+    }
+    return int(texelFetch(summed_area, cell, 0).r);
+}
+
+// alive cells in the rectangle from low to high, inside the grid
+int boxSum(ivec2 low, ivec2 high)
+{
+    return prefixSum(high) - prefixSum(ivec2(low.x - 1, high.y)) - prefixSum(ivec2(high.x, low.y - 1)) + prefixSum(low - 1);
+}
+
+/**
+  The square of the neighbourhood wraps around the torus, it is split in at most 4 rectangles inside the grid:
+  4 fetches per rectangle, whatever the radius. The grid is at least as large as the square (see LifeRule::fitsGrid),
+  so the square only runs past one of the edges of each axis
+*/
+int neighbourhoodSum(ivec2 cell)
+{
+    ivec2 low = cell - RADIUS;
+    ivec2 high = cell + RADIUS;
+    // first and second interval along each axis, the second is empty if the square does not wrap
+    ivec4 x_intervals = ivec4(max(low.x, 0), min(high.x, grid_size.x - 1), 1, 0);
+    ivec4 y_intervals = ivec4(max(low.y, 0), min(high.y, grid_size.y - 1), 1, 0);
+    if (low.x < 0)
+    {
+        x_intervals.zw = ivec2(low.x + grid_size.x, grid_size.x - 1);
+    }
+    else if (high.x >= grid_size.x)
+    {
+        x_intervals.zw = ivec2(0, high.x - grid_size.x);
+    }
+    if (low.y < 0)
+    {
+        y_intervals.zw = ivec2(low.y + grid_size.y, grid_size.y - 1);
+    }
+    else if (high.y >= grid_size.y)
+    {
+        y_intervals.zw = ivec2(0, high.y - grid_size.y);
+    }
+
+    int sum = boxSum(ivec2(x_intervals.x, y_intervals.x), ivec2(x_intervals.y, y_intervals.y));
+    if (x_intervals.z <= x_intervals.w)
+    {
+        sum += boxSum(ivec2(x_intervals.z, y_intervals.x), ivec2(x_intervals.w, y_intervals.y));
+    }
+    if (y_intervals.z <= y_intervals.w)
+    {
+        sum += boxSum(ivec2(x_intervals.x, y_intervals.z), ivec2(x_intervals.y, y_intervals.w));
+        if (x_intervals.z <= x_intervals.w)
+        {
+            sum += boxSum(ivec2(x_intervals.z, y_intervals.z), ivec2(x_intervals.w, y_intervals.w));
+        }
+    }
+    return sum;
+}
+
+/**
+  Next state of a cell under a Larger than Life rule, with the same texel encoding as fragment.glsl
+*/
+void main()
+{
+    ivec2 cell = ivec2(gl_FragCoord.xy);
+    int texel = int(texelFetch(source_texture, cell, 0).r * 255.0 + 0.5);
+    bool self = texel >= 128;
+
+    int count = neighbourhoodSum(cell);
+#ifndef INCLUDE_CENTRE
+    count -= int(self);
+#endif
+
+    int next;
+    if (self)
+    {
+        next = count >= SURVIVAL_MIN && count <= SURVIVAL_MAX ? 255 : STATES - 2;
+    }
+    else if (texel > 0)
+    {
+        // dying cell
+        next = texel - 1;
+    }
+    else
+    {
+        next = count >= BIRTH_MIN && count <= BIRTH_MAX ? 255 : 0;
+    }
+    FragColor = vec4(float(next) / 255.0, 0, 0, 1);
+}
@@ -0,0 +1,29 @@
+#version 330 core
+out vec4 FragColor;
+
+// copied cells, in the encoding of the state textures
+uniform sampler2D clipboard_texture;
+// cell of the grid at the bottom left corner of the pasted rectangle, and its size once rotated
+uniform ivec2 box_origin;
+uniform ivec2 pasted_size;
+// the copied cells are mirrored left to right first, then turned counterclockwise (see clipboard.hpp)
+uniform int quarter_turns;
+uniform bool flipped;
+
+// drawn over the pasted rectangle of the current generation only
+void main()
+{
+  ivec2 cell = ivec2(gl_FragCoord.xy) - box_origin;
+  ivec2 size = pasted_size;
+  // undoing the turns one by one
+  for (int i = 0; i < quarter_turns; ++i)
+  {
+    cell = ivec2(cell.y, size.x - 1 - cell.x);
+    size = size.yx;
+  }
+  if (flipped)
+  {
+    cell.x = size.x - 1 - cell.x;
+  }
+  FragColor = vec4(texelFetch(clipboard_texture, cell, 0).r);
+}
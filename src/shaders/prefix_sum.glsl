@@ -0,0 +1,36 @@
+#version 330 core
+out uint PartialSum;
+
+// state of the grid, read by the first pass only
+uniform sampler2D state_texture;
+// output of the previous pass
+uniform usampler2D partial_sums;
+uniform bool from_state;
+// distance to the added texel, a power of two along a single axis
+uniform ivec2 offset;
+
+uint valueAt(ivec2 cell)
+{
+    if (from_state)
+    {
+        // only alive cells are counted, dying cells of Generations rules are below the alive bit
+        return uint(texelFetch(state_texture, cell, 0).r > 0.5);
+    }
+    return texelFetch(partial_sums, cell, 0).r;
+}
+
+/**
+  One pass of an inclusive prefix sum (Hillis and Steele): after the passes of offsets 1, 2, 4, ... along x then
+  along y, texel (x, y) holds the number of alive cells in the rectangle from (0, 0) to (x, y)
+*/
+void main()
+{
+    ivec2 cell = ivec2(gl_FragCoord.xy);
+    uint sum = valueAt(cell);
+    ivec2 added = cell - offset;
+    if (added.x >= 0 && added.y >= 0)
+    {
+        sum += valueAt(added);
+    }
+    PartialSum = sum;
+}
@@ -0,0 +1,29 @@
+#version 330 core
+out uvec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform usampler2D partial_sums;
+uniform ivec2 source_size;
+
+/**
+  Each output texel is the sum of a 16x16 block of partial sums, integer additions wrap around like the cpu ones
+*/
+void main()
+{
+    ivec2 origin = ivec2(gl_FragCoord.xy) * 16;
+    uvec4 sum = uvec4(0u);
+
+    for (int y = 0; y < 16; ++y)
+    {
+        for (int x = 0; x < 16; ++x)
+        {
+            ivec2 texel = origin + ivec2(x, y);
+            if (texel.x < source_size.x && texel.y < source_size.y)
+            {
+                sum += texelFetch(partial_sums, texel, 0);
+            }
+        }
+    }
+    FragColor = sum;
+}
@@ -0,0 +1,31 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+// one texel per character, the index of its glyph, first line in row 0
+uniform usampler2D text_texture;
+// glyphs side by side, 1 for the lit pixels, top row of the glyphs in row 0
+uniform usampler2D font_texture;
+// size of the panel in font pixels, with its margin
+uniform ivec2 panel_size;
+
+// size of a glyph with its spacing
+const ivec2 glyph_size = ivec2(6, 8);
+
+void main()
+{
+  const vec4 background = vec4(0.0, 0.0, 0.0, 0.6);
+  // the panel covers the viewport, text is written from its top left corner after a pixel of margin
+  ivec2 pixel = min(ivec2(vec2(TexCoord.x, 1.0 - TexCoord.y) * vec2(panel_size)), panel_size - 1) - 1;
+  if (pixel.x < 0 || pixel.y < 0)
+  {
+    FragColor = background;
+    return;
+  }
+  ivec2 character = pixel / glyph_size;
+  ivec2 glyph_pixel = pixel % glyph_size;
+
+  uint glyph = texelFetch(text_texture, character, 0).r;
+  uint lit = texelFetch(font_texture, ivec2(int(glyph) * glyph_size.x + glyph_pixel.x, glyph_pixel.y), 0).r;
+  FragColor = lit != 0u ? vec4(1.0, 1.0, 0.6, 1.0) : background;
+}
@@ -0,0 +1,53 @@
+#version 330 core
+layout (location = 1) in vec2 aTexCoord;
+
+out vec2 TexCoord;
+
+// one instance per tile, row after row
+uniform ivec2 tile_grid;
+uniform ivec2 grid_size;
+
+// side of a tile, baked in by TileStepper
+#ifndef TILE_SIZE
+#define TILE_SIZE 32
+#endif
+// tiles whose cells changed during the last generation
+uniform sampler2D tile_changes;
+// every tile is stepped, tile_changes is ignored
+uniform bool all_active;
+
+/**
+  A tile has to be stepped if itself or one of its neighbours changed, the others keep their state
+*/
+bool isActive(ivec2 tile)
+{
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            ivec2 neighbour = (tile + ivec2(dx, dy) + tile_grid) % tile_grid;
+            if (texelFetch(tile_changes, neighbour, 0).r > 0.5)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void main()
+{
+    ivec2 tile = ivec2(gl_InstanceID % tile_grid.x, gl_InstanceID / tile_grid.x);
+    if (!all_active && !isActive(tile))
+    {
+        // every vertex at the same place, the quad covers no fragment
+        gl_Position = vec4(-2.0, -2.0, 0.0, 1.0);
+        TexCoord = vec2(0.0);
+        return;
+    }
+
+    // same texture coordinates as the full screen quad, restricted to the tile
+    // a single tile is the whole quad, it is how full passes are drawn
+    TexCoord = tile_grid == ivec2(1) ? aTexCoord : (vec2(tile) + aTexCoord) * float(TILE_SIZE) / vec2(grid_size);
+    gl_Position = vec4(TexCoord * 2.0 - 1.0, 0.0, 1.0);
+}
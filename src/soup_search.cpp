@@ -0,0 +1,359 @@
+#include "soup_search.hpp"
+
+#include <algorithm>
+#include <iostream> // needed for std::cout
+#include <string>
+
+namespace
+{
+    uint64_t splitmix64(uint64_t &state)
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    const int census_readback_count = 4;
+    // soups listed by the final report
+    const size_t longest_soup_count = 5;
+
+    // orders the heap of the longest lived soups, the shortest one on top
+    bool livesLonger(const SoupResult &a, const SoupResult &b)
+    {
+        return a.stabilization > b.stabilization;
+    }
+}
+
+SoupSearch::SoupSearch(ShaderCache &shader_cache, unsigned int quad_vao, const SoupSearchSettings &settings, const LifeRule &rule, const ShaderDefines &rule_defines)
+    : settings(settings), quad_vao(quad_vao),
+      width(settings.universe_size * settings.universes_x), height(settings.universe_size * settings.universes_y),
+      // a glider crosses a universe and comes back in 4 * universe_size generations, the history has to hold that period
+      universes(settings.universes_x * settings.universes_y, Universe{-1, 0, false, CycleDetector(4 * settings.universe_size + 8)}),
+      hasher(shader_cache, quad_vao, width, height, settings.universe_size, false),
+      census(rule), census_readbacks(census_readback_count)
+{
+    ShaderDefines defines = rule_defines;
+    defines.push_back({"UNIVERSE_SIZE", std::to_string(settings.universe_size)});
+    program_id = shader_cache.getProgram("vertex.glsl", "fragment.glsl", defines);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        glGenTextures(1, &textures[i]);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &fbos[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbos[i]);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textures[i], 0);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (CensusReadback &readback : census_readbacks)
+    {
+        glGenBuffers(1, &readback.pbo);
+    }
+
+    soup_cells.resize(settings.universe_size * settings.universe_size);
+    for (int i = 0; i < int(universes.size()); ++i)
+    {
+        seedUniverse(i);
+    }
+    last_report = std::chrono::steady_clock::now();
+}
+
+SoupSearch::~SoupSearch()
+{
+    hasher.discardPending();
+    for (CensusReadback &readback : census_readbacks)
+    {
+        if (readback.fence != nullptr)
+        {
+            glDeleteSync(readback.fence);
+        }
+        glDeleteBuffers(1, &readback.pbo);
+    }
+    glDeleteFramebuffers(2, fbos);
+    glDeleteTextures(2, textures);
+}
+
+void SoupSearch::step(int generations)
+{
+    glBindVertexArray(quad_vao);
+    glViewport(0, 0, width, height);
+    for (int i = 0; i < generations && !isFinished(); ++i)
+    {
+        glUseProgram(program_id);
+        glActiveTexture(GL_TEXTURE0);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbos[1 - source]);
+        glBindTexture(GL_TEXTURE_2D, textures[source]);
+        glUniform1i(glGetUniformLocation(program_id, "source_texture"), 0);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        source = 1 - source;
+        generation++;
+
+        // every generation has to be hashed, so a full ring waits for its oldest result instead of dropping it
+        long hashed_generation;
+        if (hasher.inFlight() == hasher.capacity() && hasher.pollBlocks(hashed_generation, block_hashes, true))
+        {
+            processHashes(hashed_generation, block_hashes);
+        }
+        hasher.submit(textures[source], generation);
+        while (hasher.pollBlocks(hashed_generation, block_hashes))
+        {
+            processHashes(hashed_generation, block_hashes);
+        }
+
+        // settled universes are still cycling, whatever phase is read back holds the same objects
+        if (!to_census.empty())
+        {
+            submitCensus();
+        }
+        while (pollCensus(false))
+        {
+        }
+
+        // the new soups are the state of the current generation, the hashes in flight still see the old ones
+        for (int index : to_seed)
+        {
+            seedUniverse(index);
+        }
+        to_seed.clear();
+
+        // the hasher leaves its own framebuffer and viewport bound
+        glBindVertexArray(quad_vao);
+        glViewport(0, 0, width, height);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool SoupSearch::isFinished() const
+{
+    return settings.soup_count > 0 && finished_soups >= settings.soup_count;
+}
+
+void SoupSearch::seedUniverse(int index)
+{
+    Universe &universe = universes[index];
+    bool was_idle = universe.soup_index < 0;
+    universe.detector.reset();
+    universe.done = false;
+    universe.seeded_generation = generation;
+
+    std::fill(soup_cells.begin(), soup_cells.end(), 0);
+    if (settings.soup_count > 0 && next_soup >= settings.soup_count)
+    {
+        universe.soup_index = -1;
+        if (was_idle)
+        {
+            // already empty
+            return;
+        }
+    }
+    else
+    {
+        universe.soup_index = next_soup++;
+        uint64_t state = settings.seed;
+        state = splitmix64(state) ^ uint64_t(universe.soup_index);
+        int offset = (settings.universe_size - settings.soup_size) / 2;
+        uint64_t bits = 0;
+        for (int i = 0; i < settings.soup_size * settings.soup_size; ++i)
+        {
+            if (i % 64 == 0)
+            {
+                bits = splitmix64(state);
+            }
+            int x = offset + i % settings.soup_size;
+            int y = offset + i / settings.soup_size;
+            soup_cells[y * settings.universe_size + x] = (bits >> (i % 64)) & 1 ? 255 : 0;
+        }
+    }
+
+    int x = (index % settings.universes_x) * settings.universe_size;
+    int y = (index / settings.universes_x) * settings.universe_size;
+    glBindTexture(GL_TEXTURE_2D, textures[source]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, settings.universe_size, settings.universe_size, GL_RED, GL_UNSIGNED_BYTE, soup_cells.data());
+}
+
+void SoupSearch::processHashes(long hashed_generation, const std::vector<StateHash> &hashes)
+{
+    for (int i = 0; i < int(universes.size()); ++i)
+    {
+        Universe &universe = universes[i];
+        // hashes submitted before a reseed belong to the previous soup
+        if (universe.soup_index < 0 || universe.done || hashed_generation <= universe.seeded_generation)
+        {
+            continue;
+        }
+
+        long age = hashed_generation - universe.seeded_generation;
+        SoupResult result{universe.soup_index, 0, 0, hashes[i].population};
+        if (universe.detector.add(age, hashes[i]))
+        {
+            result.stabilization = universe.detector.cycleStart();
+            result.period = universe.detector.period();
+        }
+        else if (age >= settings.max_generations)
+        {
+            result.stabilization = settings.max_generations;
+        }
+        else
+        {
+            continue;
+        }
+
+        universe.done = true;
+        to_seed.push_back(i);
+        if (settings.census && result.period > 0 && result.population > 0)
+        {
+            to_census.push_back({i, result.period});
+        }
+        finished_soups++;
+        if (longest_soups.size() < longest_soup_count)
+        {
+            longest_soups.push_back(result);
+            std::push_heap(longest_soups.begin(), longest_soups.end(), livesLonger);
+        }
+        else if (livesLonger(result, longest_soups.front()))
+        {
+            std::pop_heap(longest_soups.begin(), longest_soups.end(), livesLonger);
+            longest_soups.back() = result;
+            std::push_heap(longest_soups.begin(), longest_soups.end(), livesLonger);
+        }
+        period_histogram[result.period]++;
+        total_stabilization += result.stabilization;
+        if (result.period > 0 && result.population == 0)
+        {
+            died_out++;
+        }
+    }
+}
+
+void SoupSearch::submitCensus()
+{
+    CensusReadback &readback = census_readbacks[next_census];
+    if (readback.fence != nullptr)
+    {
+        pollCensus(true);
+    }
+
+    size_t universe_bytes = settings.universe_size * settings.universe_size;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    if (readback.capacity < to_census.size() * universe_bytes)
+    {
+        readback.capacity = to_census.size() * universe_bytes;
+        glBufferData(GL_PIXEL_PACK_BUFFER, readback.capacity, NULL, GL_STREAM_READ);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[source]);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    readback.periods.clear();
+    for (size_t i = 0; i < to_census.size(); ++i)
+    {
+        int index = to_census[i].first;
+        int x = (index % settings.universes_x) * settings.universe_size;
+        int y = (index / settings.universes_x) * settings.universe_size;
+        glReadPixels(x, y, settings.universe_size, settings.universe_size, GL_RED, GL_UNSIGNED_BYTE, (void *)(i * universe_bytes));
+        readback.periods.push_back(to_census[i].second);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    next_census = (next_census + 1) % census_readbacks.size();
+    to_census.clear();
+}
+
+bool SoupSearch::pollCensus(bool wait)
+{
+    CensusReadback &readback = census_readbacks[oldest_census];
+    if (readback.fence == nullptr)
+    {
+        return false;
+    }
+    GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+    {
+        return false;
+    }
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+    oldest_census = (oldest_census + 1) % census_readbacks.size();
+
+    size_t universe_bytes = settings.universe_size * settings.universe_size;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    const uint8_t *cells = static_cast<const uint8_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.periods.size() * universe_bytes, GL_MAP_READ_BIT));
+    if (cells != NULL)
+    {
+        for (size_t i = 0; i < readback.periods.size(); ++i)
+        {
+            census.addUniverse(cells + i * universe_bytes, settings.universe_size, readback.periods[i]);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void SoupSearch::report(bool force)
+{
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - last_report).count();
+    if (!force && elapsed < 1.0)
+    {
+        return;
+    }
+
+    long soups = finished_soups;
+    std::cout << "soups " << soups << " (" << (soups - reported_soups) / elapsed << "/s) | "
+              << (generation - reported_generation) / elapsed << " gens/s x " << universes.size() << " universes";
+    if (soups > 0)
+    {
+        std::cout << " | mean stabilization " << double(total_stabilization) / soups << " | died out " << died_out << " | periods";
+        for (const auto &[period, count] : period_histogram)
+        {
+            if (period > 0)
+            {
+                std::cout << " " << period << ":" << count;
+            }
+        }
+        std::cout << " | unstable " << period_histogram[0];
+    }
+    std::cout << std::endl;
+
+    if (force && settings.census)
+    {
+        // the readbacks still in flight belong to this report
+        while (pollCensus(true))
+        {
+        }
+        census.print(std::cout, 20);
+    }
+
+    if (force && soups > 0)
+    {
+        // the longest lived soups are the interesting ones, their index is enough to regenerate them
+        std::vector<SoupResult> longest = longest_soups;
+        std::sort(longest.begin(), longest.end(), livesLonger);
+        for (const SoupResult &result : longest)
+        {
+            std::cout << "  soup " << result.soup_index << ": ";
+            if (result.period > 0)
+            {
+                std::cout << "period " << result.period << " from generation " << result.stabilization;
+            }
+            else
+            {
+                std::cout << "unstable after " << result.stabilization << " generations";
+            }
+            std::cout << ", population " << result.population << std::endl;
+        }
+    }
+
+    last_report = now;
+    reported_soups = soups;
+    reported_generation = generation;
+}
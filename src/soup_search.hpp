@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <glad/glad.h> // needed to handle opengl function pointers
+#include <map>
+#include <vector>
+
+#include "census.hpp"
+#include "cycle_detector.hpp"
+#include "shader.hpp"
+#include "state_hash.hpp"
+
+struct SoupSearchSettings
+{
+    // side of every universe, each one is a torus of its own
+    int universe_size{32};
+    // the atlas holds universes_x * universes_y universes
+    int universes_x{64};
+    int universes_y{64};
+    // side of the random square seeded in the middle of each universe
+    int soup_size{16};
+    // soups still running after this many generations are counted as unstable
+    long max_generations{4000};
+    // 0 to search forever
+    long soup_count{0};
+    // soup n is always seeded from (seed, n), so any reported soup can be regenerated
+    uint64_t seed{1};
+    // classify the objects left by every settled soup
+    bool census{true};
+};
+
+/**
+ * Result of a single soup, generations are counted from its seeding
+ **/
+struct SoupResult
+{
+    long soup_index{0};
+    // first generation of the final cycle, or max_generations when unstable
+    long stabilization{0};
+    // 0 when unstable
+    long period{0};
+    long population{0};
+};
+
+/**
+ * Run thousands of small random soups at once until each of them settles
+ * Universes are tiled in a single atlas texture and stepped by a single draw: the UNIVERSE_SIZE variant of the
+ * game-of-life shader wraps neighbours inside each universe. The hash pass sums one block per universe, so each
+ * universe gets its own cycle detector. A universe that settled (or ran for too long) is reseeded in place with the
+ * next soup while the other ones keep running
+ * Settled universes are read back asynchronously before being reseeded, and their objects counted in an ObjectCensus
+ **/
+class SoupSearch
+{
+public:
+    SoupSearch(ShaderCache &shader_cache, unsigned int quad_vao, const SoupSearchSettings &settings, const LifeRule &rule, const ShaderDefines &rule_defines);
+    ~SoupSearch();
+
+    SoupSearch(const SoupSearch &) = delete;
+    SoupSearch &operator=(const SoupSearch &) = delete;
+
+    // false if a program failed to build
+    bool isValid() const { return program_id != 0; }
+
+    /**
+     * Step every universe by generations, reseeding the ones that settled
+     **/
+    void step(int generations);
+
+    // every requested soup has a result
+    bool isFinished() const;
+
+    /**
+     * Print the throughput and statistics since the last report, at most once per second unless forced
+     **/
+    void report(bool force = false);
+
+    long finishedSoups() const { return finished_soups; }
+    // the longest lived soups so far, in no particular order
+    const std::vector<SoupResult> &longestSoups() const { return longest_soups; }
+    const ObjectCensus &objectCensus() const { return census; }
+
+private:
+    struct Universe
+    {
+        long soup_index{-1}; // -1 when idle
+        long seeded_generation{0};
+        bool done{false};
+        CycleDetector detector;
+    };
+    // settled universes copied into a pixel buffer, packed one after the other
+    struct CensusReadback
+    {
+        unsigned int pbo{0};
+        GLsync fence{nullptr};
+        size_t capacity{0};
+        std::vector<long> periods;
+    };
+
+    void seedUniverse(int index);
+    void processHashes(long generation, const std::vector<StateHash> &hashes);
+    // queue the readback of the universes waiting for the census
+    void submitCensus();
+    // count the objects of the oldest readback once complete
+    bool pollCensus(bool wait);
+
+    SoupSearchSettings settings;
+    unsigned int quad_vao;
+    unsigned int program_id{0};
+    unsigned int fbos[2]{0, 0};
+    unsigned int textures[2]{0, 0};
+    int source{0};
+    int width, height;
+    long generation{0};
+
+    std::vector<Universe> universes;
+    std::vector<int> to_seed;
+    // universe index and period of the settled universes to read back
+    std::vector<std::pair<int, long>> to_census;
+    std::vector<StateHash> block_hashes;
+    std::vector<uint8_t> soup_cells;
+    GpuStateHasher hasher;
+
+    long next_soup{0};
+    long finished_soups{0};
+    // only the longest lived soups are kept, a min-heap on their stabilization so the shortest is replaced first
+    std::vector<SoupResult> longest_soups;
+    // number of soups per final period, 0 for unstable ones
+    std::map<long, long> period_histogram;
+    long total_stabilization{0};
+    long died_out{0};
+
+    ObjectCensus census;
+    std::vector<CensusReadback> census_readbacks;
+    int next_census{0};
+    int oldest_census{0};
+
+    // statistics since the last report
+    std::chrono::steady_clock::time_point last_report;
+    long reported_soups{0};
+    long reported_generation{0};
+};
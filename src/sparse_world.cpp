@@ -0,0 +1,342 @@
+#include "sparse_world.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream> // needed for std::cout
+
+namespace
+{
+    long floorDiv(long a, long b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+}
+
+SparseWorld::SparseWorld(const LifeRule &rule, int threads)
+    : rule(rule), kernel(selectRowKernel(rule)), workers(threads)
+{
+}
+
+SparseWorld::~SparseWorld() = default;
+
+SparseWorld::Chunk *SparseWorld::find(long cx, long cy) const
+{
+    auto found = chunks.find(key(cx, cy));
+    return found == chunks.end() ? nullptr : found->second.get();
+}
+
+SparseWorld::Chunk *SparseWorld::create(long cx, long cy)
+{
+    Chunk *existing = find(cx, cy);
+    if (existing != nullptr)
+    {
+        return existing;
+    }
+    auto chunk = std::make_unique<Chunk>();
+    chunk->cx = cx;
+    chunk->cy = cy;
+    std::memset(chunk->cells, 0, sizeof(chunk->cells));
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            Chunk *neighbour = dx == 0 && dy == 0 ? nullptr : find(cx + dx, cy + dy);
+            chunk->neighbours[dy + 1][dx + 1] = neighbour;
+            if (neighbour != nullptr)
+            {
+                neighbour->neighbours[1 - dy][1 - dx] = chunk.get();
+            }
+        }
+    }
+    Chunk *created = chunk.get();
+    chunks.emplace(key(cx, cy), std::move(chunk));
+    return created;
+}
+
+void SparseWorld::destroy(Chunk *chunk)
+{
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            Chunk *neighbour = chunk->neighbours[dy + 1][dx + 1];
+            if (neighbour != nullptr)
+            {
+                neighbour->neighbours[1 - dy][1 - dx] = nullptr;
+            }
+        }
+    }
+    chunks.erase(key(chunk->cx, chunk->cy));
+}
+
+void SparseWorld::set(long x, long y, bool alive)
+{
+    long cx = floorDiv(x, chunk_size), cy = floorDiv(y, chunk_size);
+    Chunk *chunk = alive ? create(cx, cy) : find(cx, cy);
+    if (chunk == nullptr)
+    {
+        return;
+    }
+    int local_x = int(x - cx * chunk_size), local_y = int(y - cy * chunk_size);
+    uint64_t bit = uint64_t(1) << (local_x % 64);
+    // both buffers, a chunk that is not stepped keeps reading the other one
+    for (auto &cells : chunk->cells)
+    {
+        uint64_t &word = cells[local_y * chunk_words + local_x / 64];
+        word = alive ? word | bit : word & ~bit;
+    }
+    chunk->changed = true;
+    updateBorders(*chunk);
+}
+
+bool SparseWorld::get(long x, long y) const
+{
+    long cx = floorDiv(x, chunk_size), cy = floorDiv(y, chunk_size);
+    const Chunk *chunk = find(cx, cy);
+    if (chunk == nullptr)
+    {
+        return false;
+    }
+    int local_x = int(x - cx * chunk_size), local_y = int(y - cy * chunk_size);
+    return chunk->cells[generation_count % 2][local_y * chunk_words + local_x / 64] >> (local_x % 64) & 1;
+}
+
+void SparseWorld::updateBorders(Chunk &chunk)
+{
+    const uint64_t *cells = chunk.cells[generation_count % 2];
+    chunk.border_west = chunk.border_east = chunk.empty = false;
+    uint64_t any = 0;
+    for (int y = 0; y < chunk_size; ++y)
+    {
+        const uint64_t *row = cells + y * chunk_words;
+        chunk.border_west |= row[0] & 1;
+        chunk.border_east |= row[chunk_words - 1] >> 63;
+        for (int w = 0; w < chunk_words; ++w)
+        {
+            any |= row[w];
+        }
+    }
+    chunk.empty = any == 0;
+    chunk.border_north = chunk.border_south = false;
+    for (int w = 0; w < chunk_words; ++w)
+    {
+        chunk.border_north |= cells[w] != 0;
+        chunk.border_south |= cells[(chunk_size - 1) * chunk_words + w] != 0;
+    }
+}
+
+void SparseWorld::paddedRow(const Chunk &chunk, int y, uint64_t *padded) const
+{
+    // rows outside the chunk come from the north or south neighbours, along with their own west and east neighbours
+    int neighbour_y = y < 0 ? 0 : y >= chunk_size ? 2 : 1;
+    int row = y < 0 ? chunk_size - 1 : y >= chunk_size ? 0 : y;
+    int parity = generation_count % 2;
+    for (int dx = 0; dx < 3; ++dx)
+    {
+        const Chunk *source = neighbour_y == 1 && dx == 1 ? &chunk : chunk.neighbours[neighbour_y][dx];
+        const uint64_t *words = source != nullptr ? source->cells[parity] + row * chunk_words : nullptr;
+        if (dx == 0)
+        {
+            padded[0] = words != nullptr ? words[chunk_words - 1] : 0;
+        }
+        else if (dx == 1)
+        {
+            for (int w = 0; w < chunk_words; ++w)
+            {
+                padded[1 + w] = words != nullptr ? words[w] : 0;
+            }
+        }
+        else
+        {
+            padded[chunk_words + 1] = words != nullptr ? words[0] : 0;
+        }
+    }
+}
+
+void SparseWorld::stepChunk(Chunk &chunk)
+{
+    // the row kernels wrap rows around, the padding words make the wrapped bits come from the neighbours
+    const int padded_words = chunk_words + 2;
+    uint64_t rows[3][padded_words];
+    uint64_t out[padded_words];
+    paddedRow(chunk, -1, rows[0]);
+    paddedRow(chunk, 0, rows[1]);
+
+    int parity = generation_count % 2;
+    const uint64_t *source = chunk.cells[parity];
+    uint64_t *destination = chunk.cells[1 - parity];
+    bool changed = false;
+    for (int y = 0; y < chunk_size; ++y)
+    {
+        uint64_t *above = rows[y % 3], *row = rows[(y + 1) % 3], *below = rows[(y + 2) % 3];
+        paddedRow(chunk, y + 1, below);
+        kernel(above, row, below, out, padded_words, rule);
+        for (int w = 0; w < chunk_words; ++w)
+        {
+            destination[y * chunk_words + w] = out[1 + w];
+            changed |= out[1 + w] != source[y * chunk_words + w];
+        }
+    }
+    chunk.changed = changed;
+}
+
+void SparseWorld::step()
+{
+    // chunks next to alive border cells have to exist before stepping, they may get births
+    std::vector<Chunk *> changed;
+    for (auto &item : chunks)
+    {
+        if (item.second->changed)
+        {
+            changed.push_back(item.second.get());
+        }
+    }
+    for (Chunk *chunk : changed)
+    {
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                bool needed = (dy == -1 && chunk->border_north) || (dy == 1 && chunk->border_south) ||
+                              (dx == -1 && chunk->border_west) || (dx == 1 && chunk->border_east);
+                if (needed && chunk->neighbours[dy + 1][dx + 1] == nullptr)
+                {
+                    create(chunk->cx + dx, chunk->cy + dy);
+                }
+            }
+        }
+    }
+
+    // changed chunks and their neighbours
+    active.clear();
+    for (Chunk *chunk : changed)
+    {
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                Chunk *neighbour = dx == 0 && dy == 0 ? chunk : chunk->neighbours[dy + 1][dx + 1];
+                if (neighbour != nullptr && neighbour->active_generation != generation_count)
+                {
+                    neighbour->active_generation = generation_count;
+                    active.push_back(neighbour);
+                }
+            }
+        }
+    }
+    active_count = int(active.size());
+    if (active.empty())
+    {
+        generation_count++;
+        return;
+    }
+    long min_cy = active[0]->cy, max_cy = active[0]->cy;
+    for (Chunk *chunk : active)
+    {
+        min_cy = std::min(min_cy, chunk->cy);
+        max_cy = std::max(max_cy, chunk->cy);
+    }
+
+    // bands of chunk rows, as a static partition would hand them out
+    int threads = workers.threadCount();
+    std::vector<std::vector<uint32_t>> initial(threads);
+    for (uint32_t index = 0; index < active.size(); ++index)
+    {
+        long band = (active[index]->cy - min_cy) * threads / (max_cy - min_cy + 1);
+        initial[band].push_back(index);
+    }
+    workers.run(initial, [this](uint32_t index)
+                { stepChunk(*active[index]); });
+
+    // chunks that were not stepped did not change
+    for (auto &item : chunks)
+    {
+        if (item.second->active_generation != generation_count)
+        {
+            item.second->changed = false;
+        }
+    }
+    generation_count++;
+
+    // empty chunks away from any alive cell are dropped, a neighbour recreates them when needed
+    for (Chunk *chunk : active)
+    {
+        updateBorders(*chunk);
+    }
+    std::vector<Chunk *> empty;
+    for (Chunk *chunk : active)
+    {
+        bool isolated = chunk->empty && !chunk->changed;
+        for (int i = 0; i < 9 && isolated; ++i)
+        {
+            Chunk *neighbour = chunk->neighbours[i / 3][i % 3];
+            isolated = neighbour == nullptr || neighbour->empty;
+        }
+        if (isolated)
+        {
+            empty.push_back(chunk);
+        }
+    }
+    active.clear();
+    for (Chunk *chunk : empty)
+    {
+        destroy(chunk);
+    }
+}
+
+long SparseWorld::population() const
+{
+    long count = 0;
+    int parity = generation_count % 2;
+    for (const auto &item : chunks)
+    {
+        for (uint64_t word : item.second->cells[parity])
+        {
+            count += __builtin_popcountll(word);
+        }
+    }
+    return count;
+}
+
+int runSparseWorld(const SparseSettings &settings, const LifeRule &rule)
+{
+    if (!rule.isBinary())
+    {
+        std::cout << "the sparse world only runs rules of two states on the 8 neighbours" << std::endl;
+        return -1;
+    }
+
+    // Gosper glider gun, rows separated by '/'
+    const char *gun = "........................o/......................o.o/............oo......oo............oo/"
+                      "...........o...o....oo............oo/oo........o.....o...oo/oo........o...o.oo....o.o/"
+                      "..........o.....o.......o/...........o...o/............oo";
+    SparseWorld world(rule, settings.threads);
+    long x = 0, y = 0;
+    for (const char *c = gun; *c != '\0'; ++c)
+    {
+        if (*c == '/')
+        {
+            x = 0;
+            y++;
+            continue;
+        }
+        world.set(x++, y, *c == 'o');
+    }
+
+    std::cout << "stepping a glider gun for " << settings.generations << " generations on " << world.pool().threadCount() << " threads" << std::endl;
+    auto begin = std::chrono::steady_clock::now();
+    long active_total = 0;
+    for (long generation = 0; generation < settings.generations; ++generation)
+    {
+        world.step();
+        active_total += world.activeCount();
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    const WorkStealingPool &pool = world.pool();
+    std::cout << "generation " << world.generation() << ": population " << world.population() << ", " << world.chunkCount() << " chunks, "
+              << double(active_total) / std::max(1L, settings.generations) << " active per generation | " << elapsed_ms << "ms, "
+              << pool.stealCount() << " steals moved " << pool.stolenCount() << " chunks" << std::endl;
+    return 0;
+}
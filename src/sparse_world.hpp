@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "work_stealing.hpp"
+
+/**
+ * Unbounded world made of square chunks of chunk_size cells, only the chunks around alive cells exist
+ * A chunk is only stepped if itself or one of its 8 neighbours changed during the last generation, the others
+ * already hold their next state in their other buffer (same reasoning as TileStepper). Active chunks are stepped in
+ * parallel by a WorkStealingPool: they start in the deque of the worker owning their band of rows, as a static
+ * partition would place them, and idle workers steal them when the activity is concentrated in a few bands
+ **/
+class SparseWorld
+{
+public:
+    // cells per side of a chunk, a multiple of 64
+    static constexpr int chunk_size = 128;
+    static constexpr int chunk_words = chunk_size / 64;
+
+    SparseWorld(const LifeRule &rule, int threads = 0);
+    ~SparseWorld();
+
+    SparseWorld(const SparseWorld &) = delete;
+    SparseWorld &operator=(const SparseWorld &) = delete;
+
+    void set(long x, long y, bool alive);
+    bool get(long x, long y) const;
+
+    void step();
+
+    long population() const;
+    long generation() const { return generation_count; }
+    int chunkCount() const { return int(chunks.size()); }
+    // chunks stepped during the last generation
+    int activeCount() const { return active_count; }
+    const WorkStealingPool &pool() const { return workers; }
+
+private:
+    struct Chunk
+    {
+        long cx, cy;
+        // state of the even and odd generations, row after row
+        uint64_t cells[2][chunk_size * chunk_words];
+        // neighbours[dy + 1][dx + 1], null if they do not exist
+        Chunk *neighbours[3][3];
+        // changed during the last step, stepped again with its neighbours
+        bool changed{true};
+        // alive cells on the borders, their neighbours must exist
+        bool border_north{false}, border_south{false}, border_west{false}, border_east{false};
+        bool empty{true};
+        long active_generation{-1};
+    };
+
+    static uint64_t key(long cx, long cy) { return (uint64_t(uint32_t(cx)) << 32) | uint32_t(cy); }
+    Chunk *find(long cx, long cy) const;
+    Chunk *create(long cx, long cy);
+    void destroy(Chunk *chunk);
+
+    /**
+     * Row y of the chunk, with one word of its west neighbour before it and one word of its east neighbour after it
+     * y goes from -1 (last row of the north neighbours) to chunk_size (first row of the south neighbours)
+     **/
+    void paddedRow(const Chunk &chunk, int y, uint64_t *padded) const;
+    void stepChunk(Chunk &chunk);
+    void updateBorders(Chunk &chunk);
+
+    LifeRule rule;
+    RowKernel kernel;
+    std::unordered_map<uint64_t, std::unique_ptr<Chunk>> chunks;
+    // only valid while stepping
+    std::vector<Chunk *> active;
+    int active_count{0};
+    long generation_count{0};
+    WorkStealingPool workers;
+};
+
+struct SparseSettings
+{
+    long generations{10000};
+    // 0 for one worker per cpu
+    int threads{0};
+};
+
+/**
+ * Run a Gosper glider gun in an unbounded SparseWorld, without any window: its glider stream keeps a thin diagonal
+ * of chunks active, the case where a static partition of the rows leaves most workers idle
+ * Return 0 on success
+ **/
+int runSparseWorld(const SparseSettings &settings, const LifeRule &rule);
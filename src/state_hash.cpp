@@ -0,0 +1,232 @@
+#include "state_hash.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace
+{
+    const int reduction_block = 16;
+    // the last level is read back once it has at most this many texels
+    const int max_readback_texels = 1024;
+    const int readback_count = 4;
+}
+
+StateHash hashGrid(const BitGrid &grid)
+{
+    uint32_t low = 0, high = 0;
+    for (int y = 0; y < grid.height; ++y)
+    {
+        const uint64_t *words = grid.row(y);
+        for (int w = 0; w < grid.words_per_row; ++w)
+        {
+            for (uint64_t word = words[w]; word != 0; word &= word - 1)
+            {
+                int x = w * 64 + __builtin_ctzll(word);
+                uint64_t cell = cellHash(x, y);
+                low += uint32_t(cell);
+                high += uint32_t(cell >> 32);
+            }
+        }
+    }
+    return {(uint64_t(high) << 32) | low, grid.population()};
+}
+
+GpuStateHasher::GpuStateHasher(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height, int block_size, bool reduce)
+    : shader_cache(shader_cache), quad_vao(quad_vao), width(width), height(height)
+{
+    ShaderDefines hash_defines;
+    if (block_size != reduction_block)
+    {
+        hash_defines.push_back({"BLOCK_SIZE", std::to_string(block_size)});
+    }
+    hash_program_key = shader_cache.requestProgram("vertex.glsl", "hash.glsl", hash_defines);
+    reduce_program_key = shader_cache.requestProgram("vertex.glsl", "reduce.glsl");
+
+    // the first level is block_size times smaller than the grid, the next ones 16 times smaller than the previous one
+    int level_width = width, level_height = height;
+    int block = block_size;
+    do
+    {
+        level_width = (level_width + block - 1) / block;
+        level_height = (level_height + block - 1) / block;
+        block = reduction_block;
+
+        Level level{level_width, level_height};
+        glGenTextures(1, &level.texture);
+        glBindTexture(GL_TEXTURE_2D, level.texture);
+        // lane 0, lane 1, population
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32UI, level_width, level_height, 0, GL_RGBA_INTEGER, GL_UNSIGNED_INT, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &level.fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, level.fbo);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, level.texture, 0);
+        levels.push_back(level);
+    } while (reduce && level_width * level_height > max_readback_texels);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    const Level &last = levels.back();
+    result.resize(last.width * last.height * 4);
+    readbacks.resize(readback_count);
+    for (Readback &readback : readbacks)
+    {
+        glGenBuffers(1, &readback.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, result.size() * sizeof(uint32_t), NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+GpuStateHasher::~GpuStateHasher()
+{
+    discardPending();
+    for (Readback &readback : readbacks)
+    {
+        glDeleteBuffers(1, &readback.pbo);
+    }
+    for (Level &level : levels)
+    {
+        glDeleteFramebuffers(1, &level.fbo);
+        glDeleteTextures(1, &level.texture);
+    }
+}
+
+void GpuStateHasher::submit(unsigned int state_texture, long generation)
+{
+    if (hash_program_id == 0 || reduce_program_id == 0)
+    {
+        // programs were requested in the constructor, they are most likely built by now
+        hash_program_id = shader_cache.finishProgram(hash_program_key);
+        reduce_program_id = shader_cache.finishProgram(reduce_program_key);
+        if (hash_program_id == 0 || reduce_program_id == 0)
+        {
+            return;
+        }
+    }
+
+    Readback &readback = readbacks[next_readback];
+    if (readback.fence != nullptr)
+    {
+        // nobody polled this result in time, the newest state is more useful than the oldest one
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+        oldest_readback = (oldest_readback + 1) % readbacks.size();
+        in_flight--;
+    }
+
+    glBindVertexArray(quad_vao);
+    glActiveTexture(GL_TEXTURE0);
+
+    // cell blocks
+    glUseProgram(hash_program_id);
+    glBindFramebuffer(GL_FRAMEBUFFER, levels[0].fbo);
+    glViewport(0, 0, levels[0].width, levels[0].height);
+    glBindTexture(GL_TEXTURE_2D, state_texture);
+    glUniform1i(glGetUniformLocation(hash_program_id, "state_texture"), 0);
+    glUniform2i(glGetUniformLocation(hash_program_id, "grid_size"), width, height);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+    // blocks of partial sums
+    glUseProgram(reduce_program_id);
+    glUniform1i(glGetUniformLocation(reduce_program_id, "partial_sums"), 0);
+    for (size_t i = 1; i < levels.size(); ++i)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, levels[i].fbo);
+        glViewport(0, 0, levels[i].width, levels[i].height);
+        glBindTexture(GL_TEXTURE_2D, levels[i - 1].texture);
+        glUniform2i(glGetUniformLocation(reduce_program_id, "source_size"), levels[i - 1].width, levels[i - 1].height);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    }
+
+    const Level &last = levels.back();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, last.fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, last.width, last.height, GL_RGBA_INTEGER, GL_UNSIGNED_INT, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.generation = generation;
+    next_readback = (next_readback + 1) % readbacks.size();
+    in_flight++;
+}
+
+bool GpuStateHasher::poll(long &generation, StateHash &hash, bool wait)
+{
+    if (!readOldest(generation, wait))
+    {
+        return false;
+    }
+    hash = StateHash{};
+    for (size_t i = 0; i < result.size(); i += 4)
+    {
+        hash = combineHashes(hash, {(uint64_t(result[i + 1]) << 32) | result[i], long(result[i + 2])});
+    }
+    return true;
+}
+
+bool GpuStateHasher::pollBlocks(long &generation, std::vector<StateHash> &hashes, bool wait)
+{
+    if (!readOldest(generation, wait))
+    {
+        return false;
+    }
+    hashes.resize(result.size() / 4);
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        hashes[i] = {(uint64_t(result[4 * i + 1]) << 32) | result[4 * i], long(result[4 * i + 2])};
+    }
+    return true;
+}
+
+bool GpuStateHasher::readOldest(long &generation, bool wait)
+{
+    Readback &readback = readbacks[oldest_readback];
+    if (readback.fence == nullptr)
+    {
+        return false;
+    }
+    // the flush makes sure the fence reaches the gpu, waiting on an unflushed fence could hang
+    GLuint64 timeout = wait ? GL_TIMEOUT_IGNORED : 0;
+    GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+    {
+        return false;
+    }
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+    oldest_readback = (oldest_readback + 1) % readbacks.size();
+    in_flight--;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    const uint32_t *texels = static_cast<const uint32_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, result.size() * sizeof(uint32_t), GL_MAP_READ_BIT));
+    if (texels == NULL)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return false;
+    }
+    std::copy_n(texels, result.size(), result.data());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    generation = readback.generation;
+    return true;
+}
+
+void GpuStateHasher::discardPending()
+{
+    for (Readback &readback : readbacks)
+    {
+        if (readback.fence != nullptr)
+        {
+            glDeleteSync(readback.fence);
+            readback.fence = nullptr;
+        }
+    }
+    next_readback = 0;
+    oldest_readback = 0;
+    in_flight = 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h> // needed to handle opengl function pointers
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "shader.hpp"
+
+/**
+ * Hash of a whole grid state, with its population
+ * The hash is the sum (modulo 2^32, on two independent lanes) of a hash of the position of every alive cell.
+ * A sum does not depend on the order cells are visited in, so gpu blocks, cpu threads or bands can compute
+ * partial sums in any order and still agree on the final value.
+ * src/shaders/hash.glsl implements the same cell hash
+ **/
+struct StateHash
+{
+    uint64_t hash{0};
+    long population{0};
+
+    bool operator==(const StateHash &other) const { return hash == other.hash && population == other.population; }
+};
+
+inline uint32_t mixHash32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+inline uint64_t cellHash(uint32_t x, uint32_t y)
+{
+    uint32_t low = mixHash32(x ^ mixHash32(y ^ 0x9e3779b9u));
+    uint32_t high = mixHash32(x ^ mixHash32(y ^ 0x85ebca6bu));
+    return (uint64_t(high) << 32) | low;
+}
+
+/**
+ * Combine partial hashes, lanes are summed independently
+ **/
+inline StateHash combineHashes(const StateHash &a, const StateHash &b)
+{
+    uint32_t low = uint32_t(a.hash) + uint32_t(b.hash);
+    uint32_t high = uint32_t(a.hash >> 32) + uint32_t(b.hash >> 32);
+    return {(uint64_t(high) << 32) | low, a.population + b.population};
+}
+
+StateHash hashGrid(const BitGrid &grid);
+
+/**
+ * Hash R8 state textures on the gpu, and read the result back without stalling
+ * A first pass sums the hashes of block_size x block_size cell blocks, further passes sum 16x16 blocks of partial
+ * sums until the result is small enough to be read back in a few kilobytes. The readback goes through pixel buffer
+ * objects, so a result is only available a couple of frames after its submission
+ * Without reduction the hash of every block is read back, batched runs use one block per universe
+ **/
+class GpuStateHasher
+{
+public:
+    GpuStateHasher(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height, int block_size = 16, bool reduce = true);
+    ~GpuStateHasher();
+
+    GpuStateHasher(const GpuStateHasher &) = delete;
+    GpuStateHasher &operator=(const GpuStateHasher &) = delete;
+
+    /**
+     * Queue the hash of state_texture, labelled with its generation
+     **/
+    void submit(unsigned int state_texture, long generation);
+
+    /**
+     * Return the oldest completed hash if there is one, only blocks until it is complete when wait is set
+     **/
+    bool poll(long &generation, StateHash &hash, bool wait = false);
+
+    /**
+     * Return the hashes of every texel of the last level, row by row, for the oldest completed submission
+     * Blocks until it is complete when wait is set
+     **/
+    bool pollBlocks(long &generation, std::vector<StateHash> &hashes, bool wait = false);
+
+    // number of blocks per row of the last level
+    int blockColumns() const { return levels.back().width; }
+    // submissions not polled yet, a full ring drops the oldest one on the next submit
+    int inFlight() const { return in_flight; }
+    int capacity() const { return int(readbacks.size()); }
+
+    /**
+     * Drop the hashes still in flight
+     **/
+    void discardPending();
+
+private:
+    struct Level
+    {
+        int width, height;
+        unsigned int texture{0};
+        unsigned int fbo{0};
+    };
+    struct Readback
+    {
+        unsigned int pbo{0};
+        GLsync fence{nullptr};
+        long generation{0};
+    };
+
+    // copy the oldest completed readback into result
+    bool readOldest(long &generation, bool wait);
+
+    ShaderCache &shader_cache;
+    uint64_t hash_program_key, reduce_program_key;
+    unsigned int hash_program_id{0}, reduce_program_id{0};
+    unsigned int quad_vao;
+    int width, height;
+    std::vector<Level> levels;
+    std::vector<Readback> readbacks;
+    int next_readback{0};
+    int oldest_readback{0};
+    int in_flight{0};
+    std::vector<uint32_t> result;
+};
@@ -0,0 +1,71 @@
+#include "summed_area.hpp"
+
+SummedAreaTable::SummedAreaTable(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height)
+    : shader_cache(shader_cache), quad_vao(quad_vao), width(width), height(height)
+{
+    program_key = shader_cache.requestProgram("vertex.glsl", "prefix_sum.glsl");
+
+    for (int i = 0; i < 2; ++i)
+    {
+        // integer textures can't be filtered
+        glGenTextures(1, &textures[i]);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &fbos[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbos[i]);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textures[i], 0);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+SummedAreaTable::~SummedAreaTable()
+{
+    glDeleteFramebuffers(2, fbos);
+    glDeleteTextures(2, textures);
+}
+
+unsigned int SummedAreaTable::build(unsigned int state_texture)
+{
+    if (program_id == 0)
+    {
+        // requested in the constructor, most likely built by now
+        program_id = shader_cache.finishProgram(program_key);
+        if (program_id == 0)
+        {
+            return 0;
+        }
+    }
+
+    glBindVertexArray(quad_vao);
+    glViewport(0, 0, width, height);
+    glUseProgram(program_id);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, state_texture);
+    glUniform1i(glGetUniformLocation(program_id, "state_texture"), 0);
+    glUniform1i(glGetUniformLocation(program_id, "partial_sums"), 1);
+
+    // rows first, then columns. The first pass reads the state, the others the previous pass
+    int output = 0;
+    bool from_state = true;
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        int size = axis == 0 ? width : height;
+        for (int offset = 1; offset < size; offset *= 2)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbos[output]);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, textures[1 - output]);
+            glUniform1i(glGetUniformLocation(program_id, "from_state"), from_state);
+            glUniform2i(glGetUniformLocation(program_id, "offset"), axis == 0 ? offset : 0, axis == 0 ? 0 : offset);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            from_state = false;
+            output = 1 - output;
+        }
+    }
+    glActiveTexture(GL_TEXTURE0);
+    // a 1x1 grid needs no pass, its table is its state
+    return from_state ? 0 : textures[1 - output];
+}
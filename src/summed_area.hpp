@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h> // needed to handle opengl function pointers
+
+#include "shader.hpp"
+
+/**
+ * Summed-area table of the alive cells of a state texture, on the gpu
+ * Texel (x, y) of the R32UI result counts the alive cells from (0, 0) to (x, y), so the population of any rectangle
+ * takes 4 fetches whatever its size: Larger than Life rules (ltl.glsl) count large neighbourhoods at a constant cost.
+ * The table is built with log2(width) + log2(height) passes of prefix_sum.glsl between two textures
+ **/
+class SummedAreaTable
+{
+public:
+    SummedAreaTable(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height);
+    ~SummedAreaTable();
+
+    SummedAreaTable(const SummedAreaTable &) = delete;
+    SummedAreaTable &operator=(const SummedAreaTable &) = delete;
+
+    /**
+     * Build the table of state_texture and return the texture holding it, 0 if the program failed to build
+     * The framebuffer binding and the viewport are changed
+     **/
+    unsigned int build(unsigned int state_texture);
+
+private:
+    ShaderCache &shader_cache;
+    uint64_t program_key;
+    unsigned int program_id{0};
+    unsigned int quad_vao;
+    int width, height;
+
+    unsigned int textures[2]{0, 0};
+    unsigned int fbos[2]{0, 0};
+};
@@ -0,0 +1,153 @@
+#include "text_overlay.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <glad/glad.h> // needed to handle opengl function pointers
+
+namespace
+{
+    const int glyph_width = 6;
+    const int glyph_height = 8;
+    const int first_character = 32;
+    const int glyph_count = 64;
+
+    // 5x7 glyphs of ascii 32 to 95, a byte per row from the top, bit 4 is the leftmost pixel
+    const uint8_t font[glyph_count][7] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, {0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00}, {0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a}, // space ! " #
+        {0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04}, {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, {0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d}, {0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00}, // $ % & '
+        {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, {0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00}, {0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00}, // ( ) * +
+        {0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08}, {0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c}, {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // , - . /
+        {0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e}, {0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e}, {0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f}, {0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e}, // 0 1 2 3
+        {0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02}, {0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e}, {0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e}, {0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 4 5 6 7
+        {0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e}, {0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c}, {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00}, {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x04, 0x08}, // 8 9 : ;
+        {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}, {0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00}, {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}, {0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // < = > ?
+        {0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e}, {0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, {0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e}, {0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e}, // @ A B C
+        {0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c}, {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f}, {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10}, {0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f}, // D E F G
+        {0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, {0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e}, {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c}, {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // H I J K
+        {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f}, {0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11}, {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, {0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}, // L M N O
+        {0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10}, {0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d}, {0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11}, {0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e}, // P Q R S
+        {0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}, {0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04}, {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a}, // T U V W
+        {0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11}, {0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x04}, {0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f}, {0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0e}, // X Y Z [
+        {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00}, {0x0e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0e}, {0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f}, // \ ] ^ _
+    };
+
+    int glyphIndex(char character)
+    {
+        if (character >= 'a' && character <= 'z')
+        {
+            character = character - 'a' + 'A';
+        }
+        int index = character - first_character;
+        return index >= 0 && index < glyph_count ? index : '?' - first_character;
+    }
+
+    unsigned int createTexture(int width, int height, const uint8_t *texels)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        // integer textures are read with texelFetch, they can't be filtered
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, texels);
+        return texture;
+    }
+}
+
+TextOverlay::TextOverlay(ShaderCache &shader_cache, unsigned int quad_vao, int columns, int rows, int scale)
+    : shader_cache(shader_cache), quad_vao(quad_vao), program(shader_cache), columns(columns), rows(rows), scale(scale)
+{
+    // the glyphs side by side, with a blank column and a blank row for spacing
+    std::vector<uint8_t> atlas(glyph_count * glyph_width * glyph_height, 0);
+    for (int glyph = 0; glyph < glyph_count; ++glyph)
+    {
+        for (int y = 0; y < 7; ++y)
+        {
+            for (int x = 0; x < 5; ++x)
+            {
+                atlas[y * glyph_count * glyph_width + glyph * glyph_width + x] = (font[glyph][y] >> (4 - x)) & 1;
+            }
+        }
+    }
+    font_texture = createTexture(glyph_count * glyph_width, glyph_height, atlas.data());
+    text_texture = createTexture(columns, rows, std::vector<uint8_t>(columns * rows, 0).data());
+    reloadShaders();
+}
+
+TextOverlay::~TextOverlay()
+{
+    glDeleteTextures(1, &font_texture);
+    glDeleteTextures(1, &text_texture);
+}
+
+void TextOverlay::reloadShaders()
+{
+    program.request(shader_cache.requestProgram("vertex.glsl", "text.glsl"));
+}
+
+void TextOverlay::updatePrograms()
+{
+    program.update();
+}
+
+bool TextOverlay::finishPrograms()
+{
+    program.update(true);
+    return program.id() != 0;
+}
+
+void TextOverlay::setLines(const std::vector<std::string> &lines)
+{
+    // blank characters pad the lines to the widest one
+    std::vector<uint8_t> text(columns * rows, glyphIndex(' '));
+    used_rows = std::min<int>(lines.size(), rows);
+    used_columns = 0;
+    for (int row = 0; row < used_rows; ++row)
+    {
+        int length = std::min<int>(lines[row].size(), columns);
+        used_columns = std::max(used_columns, length);
+        for (int column = 0; column < length; ++column)
+        {
+            text[row * columns + column] = glyphIndex(lines[row][column]);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, text_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, columns, rows, GL_RED_INTEGER, GL_UNSIGNED_BYTE, text.data());
+}
+
+void TextOverlay::draw(int screen_width, int screen_height)
+{
+    if (used_rows == 0 || used_columns == 0 || program.id() == 0)
+    {
+        return;
+    }
+    // a font pixel of margin around the text
+    int panel_width = used_columns * glyph_width + 1;
+    int panel_height = used_rows * glyph_height + 1;
+    // smaller glyphs in a small window, so that the panel and its margins fit in it whenever they can
+    int fitted_scale = scale;
+    while (fitted_scale > 1 && ((panel_width + 8) * fitted_scale > screen_width || (panel_height + 8) * fitted_scale > screen_height))
+    {
+        fitted_scale--;
+    }
+    int margin = 4 * fitted_scale;
+    glViewport(margin, screen_height - margin - panel_height * fitted_scale, panel_width * fitted_scale, panel_height * fitted_scale);
+
+    glUseProgram(program.id());
+    glUniform2i(glGetUniformLocation(program.id(), "panel_size"), panel_width, panel_height);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, text_texture);
+    glUniform1i(glGetUniformLocation(program.id(), "text_texture"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, font_texture);
+    glUniform1i(glGetUniformLocation(program.id(), "font_texture"), 1);
+    glActiveTexture(GL_TEXTURE0);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindVertexArray(quad_vao);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glDisable(GL_BLEND);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "shader.hpp"
+
+/**
+ * Lines of text drawn over the bound framebuffer, in its top left corner (text.glsl)
+ * Glyphs come from a built-in 5x7 font covering ascii 32 to 95, lower case letters are shown upper case and other
+ * characters as '?'. The font is uploaded once as an atlas texture, and the text as a small texture holding the glyph
+ * of every character, only updated when the lines change: the whole panel is a single quad whose fragment shader
+ * looks the pixel of its glyph up in the atlas
+ **/
+class TextOverlay
+{
+public:
+    // scale: screen pixels per font pixel
+    TextOverlay(ShaderCache &shader_cache, unsigned int quad_vao, int columns = 48, int rows = 10, int scale = 2);
+    ~TextOverlay();
+
+    TextOverlay(const TextOverlay &) = delete;
+    TextOverlay &operator=(const TextOverlay &) = delete;
+
+    void reloadShaders();
+    void updatePrograms();
+    // wait for the requested program, return false if there is nothing to draw with
+    bool finishPrograms();
+
+    // lines and characters past the size of the panel are cut
+    void setLines(const std::vector<std::string> &lines);
+
+    // draw the panel, blended over the framebuffer, the viewport is left on the panel
+    // glyphs are drawn smaller than the scale when the panel would not fit in the framebuffer
+    void draw(int screen_width, int screen_height);
+
+private:
+    ShaderCache &shader_cache;
+    unsigned int quad_vao;
+    ProgramSlot program;
+    int columns;
+    int rows;
+    int scale;
+    unsigned int font_texture{0};
+    unsigned int text_texture{0};
+    // characters and lines actually written, the panel is cropped to them
+    int used_columns{0};
+    int used_rows{0};
+};
@@ -0,0 +1,323 @@
+#include "threaded_stepper.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+
+namespace
+{
+    // "0-3,8-11" to 0 1 2 3 8 9 10 11
+    std::vector<int> parseCpuList(const std::string &list)
+    {
+        std::vector<int> cpus;
+        size_t position = 0;
+        while (position < list.size())
+        {
+            size_t comma = list.find(',', position);
+            std::string range = list.substr(position, comma == std::string::npos ? std::string::npos : comma - position);
+            size_t dash = range.find('-');
+            try
+            {
+                int first = std::stoi(range.substr(0, dash));
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; ++cpu)
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+            catch (const std::exception &)
+            {
+                // empty lists, trailing new lines
+            }
+            if (comma == std::string::npos)
+            {
+                break;
+            }
+            position = comma + 1;
+        }
+        return cpus;
+    }
+
+    bool allowed(int cpu)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        return sched_getaffinity(0, sizeof(set), &set) == 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &set);
+    }
+}
+
+CpuTopology CpuTopology::detect()
+{
+    CpuTopology topology;
+    DIR *directory = opendir("/sys/devices/system/node");
+    if (directory != nullptr)
+    {
+        std::vector<int> nodes;
+        while (dirent *entry = readdir(directory))
+        {
+            std::string name = entry->d_name;
+            if (name.rfind("node", 0) == 0 && name.size() > 4 && std::isdigit(name[4]))
+            {
+                nodes.push_back(std::stoi(name.substr(4)));
+            }
+        }
+        closedir(directory);
+        std::sort(nodes.begin(), nodes.end());
+        for (int node : nodes)
+        {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+            std::vector<int> cpus;
+            for (int cpu : parseCpuList(list))
+            {
+                if (allowed(cpu))
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+            // nodes of memory only, or of cpus we may not use
+            if (!cpus.empty())
+            {
+                topology.node_cpus.push_back(cpus);
+                topology.node_ids.push_back(node);
+            }
+        }
+    }
+
+    if (topology.node_cpus.empty())
+    {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (allowed(cpu))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        if (cpus.empty())
+        {
+            cpus.push_back(0);
+        }
+        topology.node_cpus.push_back(cpus);
+        topology.node_ids.push_back(0);
+    }
+    return topology;
+}
+
+int CpuTopology::cpuCount() const
+{
+    int count = 0;
+    for (const auto &cpus : node_cpus)
+    {
+        count += int(cpus.size());
+    }
+    return count;
+}
+
+ThreadedStepper::ThreadedStepper(int width, int height, int threads, bool pin)
+    : width(width), height(height), words_per_row(width / 64), topology(CpuTopology::detect())
+{
+    int cpu_count = topology.cpuCount();
+    if (threads <= 0)
+    {
+        threads = cpu_count;
+    }
+    // every band needs a row
+    threads = std::max(1, std::min(threads, height));
+
+    // consecutive workers on the same node, nodes get workers in proportion of their cpus
+    workers = std::vector<Worker>(threads);
+    band_of_row.resize(height);
+    int cpus_before = 0;
+    for (int node = 0; node < int(topology.node_cpus.size()); ++node)
+    {
+        const std::vector<int> &cpus = topology.node_cpus[node];
+        int first = int(long(threads) * cpus_before / cpu_count);
+        int end = int(long(threads) * (cpus_before + int(cpus.size())) / cpu_count);
+        for (int index = first; index < end; ++index)
+        {
+            workers[index].node = topology.node_ids[node];
+            workers[index].cpu = pin ? cpus[(index - first) % cpus.size()] : -1;
+        }
+        cpus_before += int(cpus.size());
+    }
+    for (int index = 0; index < threads; ++index)
+    {
+        Worker &worker = workers[index];
+        worker.first_row = int(long(height) * index / threads);
+        worker.rows = int(long(height) * (index + 1) / threads) - worker.first_row;
+        std::fill_n(band_of_row.begin() + worker.first_row, worker.rows, index);
+    }
+
+    for (int index = 0; index < threads; ++index)
+    {
+        workers[index].thread = std::thread(&ThreadedStepper::run, this, index);
+    }
+    // steps read the bands of the neighbours, every band has to be allocated first
+    dispatch(Command::None);
+}
+
+ThreadedStepper::~ThreadedStepper()
+{
+    dispatch(Command::Quit);
+    for (Worker &worker : workers)
+    {
+        worker.thread.join();
+    }
+}
+
+const uint64_t *ThreadedStepper::row(int generation_parity, int y) const
+{
+    const Worker &worker = workers[band_of_row[y]];
+    return worker.generations[generation_parity].data() + size_t(y - worker.first_row) * words_per_row;
+}
+
+uint64_t *ThreadedStepper::row(int generation_parity, int y)
+{
+    Worker &worker = workers[band_of_row[y]];
+    return worker.generations[generation_parity].data() + size_t(y - worker.first_row) * words_per_row;
+}
+
+void ThreadedStepper::dispatch(Command new_command)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    command = new_command;
+    command_id++;
+    remaining = int(workers.size());
+    command_ready.notify_all();
+    command_done.wait(lock, [this]()
+                      { return remaining == 0; });
+}
+
+void ThreadedStepper::waitForGeneration()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    long id = barrier_id;
+    if (++arrived == int(workers.size()))
+    {
+        arrived = 0;
+        barrier_id++;
+        generation_done.notify_all();
+        return;
+    }
+    generation_done.wait(lock, [this, id]()
+                         { return barrier_id != id; });
+}
+
+void ThreadedStepper::run(int index)
+{
+    Worker &worker = workers[index];
+    if (worker.cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(worker.cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    // first touch, from the node the worker is pinned to
+    for (auto &generation : worker.generations)
+    {
+        generation.assign(size_t(worker.rows) * words_per_row, 0);
+    }
+
+    long last_command = 0;
+    while (true)
+    {
+        Command current;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            command_ready.wait(lock, [&]()
+                               { return command_id != last_command; });
+            last_command = command_id;
+            current = command;
+        }
+
+        size_t band_words = size_t(worker.rows) * words_per_row;
+        if (current == Command::Load)
+        {
+            std::memcpy(worker.generations[parity].data(), load_source->row(worker.first_row), band_words * sizeof(uint64_t));
+        }
+        else if (current == Command::Store)
+        {
+            std::memcpy(store_destination->row(worker.first_row), worker.generations[parity].data(), band_words * sizeof(uint64_t));
+        }
+        else if (current == Command::Step)
+        {
+            RowKernel kernel = selectRowKernel(*step_rule);
+            // the parity only changes between commands, every worker reads the same one
+            int generation_parity = parity;
+            for (int generation = 0; generation < step_generations; ++generation)
+            {
+                for (int y = worker.first_row; y < worker.first_row + worker.rows; ++y)
+                {
+                    const uint64_t *above = row(generation_parity, y == 0 ? height - 1 : y - 1);
+                    const uint64_t *below = row(generation_parity, y == height - 1 ? 0 : y + 1);
+                    kernel(above, row(generation_parity, y), below, row(1 - generation_parity, y), words_per_row, *step_rule);
+                }
+                generation_parity = 1 - generation_parity;
+                // the next generation reads the rows of the neighbour bands
+                waitForGeneration();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (--remaining == 0)
+        {
+            command_done.notify_one();
+        }
+        if (current == Command::Quit)
+        {
+            return;
+        }
+    }
+}
+
+void ThreadedStepper::load(const BitGrid &grid)
+{
+    load_source = &grid;
+    dispatch(Command::Load);
+}
+
+void ThreadedStepper::store(BitGrid &grid)
+{
+    store_destination = &grid;
+    dispatch(Command::Store);
+}
+
+void ThreadedStepper::step(int generations, const LifeRule &rule)
+{
+    step_generations = generations;
+    step_rule = &rule;
+    dispatch(Command::Step);
+    parity = (parity + generations) % 2;
+}
+
+void ThreadedStepper::report(std::ostream &out) const
+{
+    out << "topology: " << topology.node_cpus.size() << " node(s), " << topology.cpuCount() << " cpu(s)" << std::endl;
+    for (size_t node = 0; node < topology.node_cpus.size(); ++node)
+    {
+        out << "  node " << topology.node_ids[node] << ": cpus";
+        for (int cpu : topology.node_cpus[node])
+        {
+            out << " " << cpu;
+        }
+        out << std::endl;
+    }
+    for (size_t index = 0; index < workers.size(); ++index)
+    {
+        const Worker &worker = workers[index];
+        out << "  worker " << index << ": rows " << worker.first_row << " to " << worker.first_row + worker.rows - 1 << " on node " << worker.node;
+        if (worker.cpu >= 0)
+        {
+            out << ", pinned to cpu " << worker.cpu;
+        }
+        out << std::endl;
+    }
+}
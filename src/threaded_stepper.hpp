@@ -0,0 +1,109 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "cpu_engine.hpp"
+
+/**
+ * Cpus of every NUMA node, as listed in /sys/devices/system/node
+ * Machines without that directory are a single node holding the cpus this process may run on
+ **/
+struct CpuTopology
+{
+    std::vector<std::vector<int>> node_cpus;
+    // number of each node in /sys/devices/system/node, nodes without usable cpus are left out
+    std::vector<int> node_ids;
+
+    static CpuTopology detect();
+    int cpuCount() const;
+};
+
+/**
+ * Multithreaded stepGrid, for machines with several sockets
+ * The grid is split in horizontal bands, one per worker. Workers are spread over the NUMA nodes (consecutive bands
+ * on the same node, so that only the first and last bands of a node read a row of another node) and pinned to a cpu
+ * of their node before allocating their band: the first touch places its pages in the memory of that node, and the
+ * band stays there since the worker never moves. Loading and storing the grid are done by the workers too
+ **/
+class ThreadedStepper
+{
+public:
+    // threads = 0 for one worker per cpu
+    ThreadedStepper(int width, int height, int threads = 0, bool pin = true);
+    ~ThreadedStepper();
+
+    ThreadedStepper(const ThreadedStepper &) = delete;
+    ThreadedStepper &operator=(const ThreadedStepper &) = delete;
+
+    void load(const BitGrid &grid);
+    void store(BitGrid &grid);
+    void step(int generations, const LifeRule &rule);
+
+    int threadCount() const { return int(workers.size()); }
+
+    /**
+     * Print the nodes, their cpus, and the band and cpu of every worker
+     **/
+    void report(std::ostream &out) const;
+
+private:
+    enum class Command
+    {
+        None,
+        Load,
+        Store,
+        Step,
+        Quit,
+    };
+
+    struct Worker
+    {
+        std::thread thread;
+        int node{0};
+        // -1 when not pinned
+        int cpu{-1};
+        int first_row{0};
+        int rows{0};
+        // the band in the even and odd generations, allocated by the worker itself
+        std::vector<uint64_t> generations[2];
+    };
+
+    void run(int index);
+    // run a command on every worker and wait for all of them
+    void dispatch(Command command);
+    // wait for every worker, between two generations
+    void waitForGeneration();
+
+    const uint64_t *row(int parity, int y) const;
+    uint64_t *row(int parity, int y);
+
+    int width, height;
+    int words_per_row;
+    CpuTopology topology;
+    std::vector<Worker> workers;
+    // worker owning each row, rows above and below a band belong to other workers
+    std::vector<int> band_of_row;
+
+    // parity of the current generation
+    int parity{0};
+
+    std::mutex mutex;
+    std::condition_variable command_ready, command_done, generation_done;
+    Command command{Command::None};
+    long command_id{0};
+    int remaining{0};
+    // generation barrier
+    int arrived{0};
+    long barrier_id{0};
+
+    // arguments of the current command
+    const BitGrid *load_source{nullptr};
+    BitGrid *store_destination{nullptr};
+    int step_generations{0};
+    const LifeRule *step_rule{nullptr};
+};
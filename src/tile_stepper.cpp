@@ -0,0 +1,192 @@
+#include "tile_stepper.hpp"
+
+#include <algorithm>
+#include <iostream> // needed for std::cout
+
+namespace
+{
+    // switching to full passes above this fraction of active tiles, back to tiles below the second one
+    const float full_pass_activity = 0.6f;
+    const float tiled_pass_activity = 0.4f;
+    const int readback_count = 4;
+}
+
+TileStepper::TileStepper(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height, int tile_size)
+    : shader_cache(shader_cache), quad_vao(quad_vao), width(width), height(height), tile_size(tile_size),
+      tiles_x((width + tile_size - 1) / tile_size), tiles_y((height + tile_size - 1) / tile_size)
+{
+    changes_program_key = shader_cache.requestProgram("vertex.glsl", "changes.glsl", defines());
+
+    for (int i = 0; i < 2; ++i)
+    {
+        glGenTextures(1, &change_textures[i]);
+        glBindTexture(GL_TEXTURE_2D, change_textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, tiles_x, tiles_y, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &change_fbos[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, change_fbos[i]);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, change_textures[i], 0);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    changes.resize(tiles_x * tiles_y);
+    readbacks.resize(readback_count);
+    for (Readback &readback : readbacks)
+    {
+        glGenBuffers(1, &readback.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, changes.size(), NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+TileStepper::~TileStepper()
+{
+    for (Readback &readback : readbacks)
+    {
+        if (readback.fence != nullptr)
+        {
+            glDeleteSync(readback.fence);
+        }
+        glDeleteBuffers(1, &readback.pbo);
+    }
+    glDeleteFramebuffers(2, change_fbos);
+    glDeleteTextures(2, change_textures);
+}
+
+void TileStepper::step(unsigned int program_id, unsigned int source_texture, unsigned int destination_texture)
+{
+    if (changes_program_id == 0)
+    {
+        // requested in the constructor, most likely built by now
+        changes_program_id = shader_cache.finishProgram(changes_program_key);
+    }
+    pollActivity();
+    // without the change pass, nothing tells which tiles can be skipped
+    bool all_active = !valid || full_pass || changes_program_id == 0;
+
+    glBindVertexArray(quad_vao);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, change_textures[current_changes]);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source_texture);
+
+    glUseProgram(program_id);
+    glUniform1i(glGetUniformLocation(program_id, "source_texture"), 0);
+    glUniform1i(glGetUniformLocation(program_id, "tile_changes"), 1);
+    glUniform2i(glGetUniformLocation(program_id, "grid_size"), width, height);
+    glUniform1i(glGetUniformLocation(program_id, "all_active"), all_active);
+    if (full_pass)
+    {
+        // a single tile covering the whole grid
+        glUniform2i(glGetUniformLocation(program_id, "tile_grid"), 1, 1);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, 1);
+    }
+    else
+    {
+        glUniform2i(glGetUniformLocation(program_id, "tile_grid"), tiles_x, tiles_y);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, tiles_x * tiles_y);
+    }
+
+    if (changes_program_id == 0)
+    {
+        valid = false;
+        return;
+    }
+
+    // marking the tiles that changed, for the next step
+    int next_changes = 1 - current_changes;
+    glBindFramebuffer(GL_FRAMEBUFFER, change_fbos[next_changes]);
+    glViewport(0, 0, tiles_x, tiles_y);
+    glUseProgram(changes_program_id);
+    glBindTexture(GL_TEXTURE_2D, source_texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, destination_texture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, change_textures[current_changes]);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(changes_program_id, "previous_state"), 0);
+    glUniform1i(glGetUniformLocation(changes_program_id, "current_state"), 1);
+    glUniform1i(glGetUniformLocation(changes_program_id, "previous_changes"), 2);
+    glUniform2i(glGetUniformLocation(changes_program_id, "tile_grid"), tiles_x, tiles_y);
+    glUniform2i(glGetUniformLocation(changes_program_id, "grid_size"), width, height);
+    glUniform1i(glGetUniformLocation(changes_program_id, "all_active"), all_active);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    current_changes = next_changes;
+    valid = true;
+
+    // reading the mask back to choose between tiles and full passes, a few frames late is fine
+    Readback &readback = readbacks[next_readback];
+    if (readback.fence != nullptr)
+    {
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+        oldest_readback = (oldest_readback + 1) % readbacks.size();
+    }
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, tiles_x, tiles_y, GL_RED, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    next_readback = (next_readback + 1) % readbacks.size();
+}
+
+void TileStepper::pollActivity()
+{
+    bool polled = false;
+    while (true)
+    {
+        Readback &readback = readbacks[oldest_readback];
+        if (readback.fence == nullptr || glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            break;
+        }
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+        oldest_readback = (oldest_readback + 1) % readbacks.size();
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        const uint8_t *texels = static_cast<const uint8_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, changes.size(), GL_MAP_READ_BIT));
+        if (texels != NULL)
+        {
+            std::copy_n(texels, changes.size(), changes.data());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            polled = true;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    if (!polled)
+    {
+        return;
+    }
+
+    // same neighbourhood as the vertex shader
+    int active = 0;
+    for (int y = 0; y < tiles_y; ++y)
+    {
+        for (int x = 0; x < tiles_x; ++x)
+        {
+            bool is_active = false;
+            for (int dy = -1; dy <= 1 && !is_active; ++dy)
+            {
+                for (int dx = -1; dx <= 1 && !is_active; ++dx)
+                {
+                    int neighbour = ((y + dy + tiles_y) % tiles_y) * tiles_x + (x + dx + tiles_x) % tiles_x;
+                    is_active = changes[neighbour] != 0;
+                }
+            }
+            active += is_active;
+        }
+    }
+    last_activity = float(active) / (tiles_x * tiles_y);
+
+    bool previous_full_pass = full_pass;
+    full_pass = full_pass ? last_activity > tiled_pass_activity : last_activity > full_pass_activity;
+    if (full_pass != previous_full_pass)
+    {
+        std::cout << (full_pass ? "full passes" : "dirty tiles") << " (" << int(last_activity * 100) << "% of the tiles active)" << std::endl;
+    }
+}
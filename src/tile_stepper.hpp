@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h> // needed to handle opengl function pointers
+#include <string>
+#include <vector>
+
+#include "shader.hpp"
+
+/**
+ * Step only the parts of the grid that can change
+ * The grid is split in tiles, and a change pass marks the tiles whose cells changed during the last generation.
+ * The game-of-life program (fragment.glsl with tile_vertex.glsl) is drawn as one instanced quad per tile, and the
+ * vertex shader collapses the quads of the tiles that neither changed nor touch a changed tile: their cells already
+ * hold the right state in the destination texture, which is the state of two generations ago.
+ * The number of changed tiles is read back asynchronously; when most tiles are active, a single quad covering the
+ * grid replaces the per-tile quads
+ **/
+class TileStepper
+{
+public:
+    TileStepper(ShaderCache &shader_cache, unsigned int quad_vao, int width, int height, int tile_size = 32);
+    ~TileStepper();
+
+    TileStepper(const TileStepper &) = delete;
+    TileStepper &operator=(const TileStepper &) = delete;
+
+    /**
+     * Draw the next generation of source_texture into the bound framebuffer, whose color buffer is
+     * destination_texture. The destination must hold the state two generations before the next one
+     **/
+    void step(unsigned int program_id, unsigned int source_texture, unsigned int destination_texture);
+
+    /**
+     * The destination texture no longer holds the state two generations before, or the program changed:
+     * the next step covers every tile
+     **/
+    void invalidate() { valid = false; }
+
+    // fraction of active tiles, as last read back
+    float activity() const { return last_activity; }
+
+    // TILE_SIZE, to add to the defines of the programs given to step
+    ShaderDefines defines() const { return {{"TILE_SIZE", std::to_string(tile_size)}}; }
+
+private:
+    struct Readback
+    {
+        unsigned int pbo{0};
+        GLsync fence{nullptr};
+    };
+
+    void pollActivity();
+
+    ShaderCache &shader_cache;
+    uint64_t changes_program_key;
+    unsigned int changes_program_id{0};
+    unsigned int quad_vao;
+    int width, height;
+    int tile_size;
+    int tiles_x, tiles_y;
+
+    // change masks of the last two generations
+    unsigned int change_textures[2]{0, 0};
+    unsigned int change_fbos[2]{0, 0};
+    int current_changes{0};
+    bool valid{false};
+    bool full_pass{true};
+    float last_activity{1.0f};
+
+    std::vector<Readback> readbacks;
+    int next_readback{0};
+    int oldest_readback{0};
+    std::vector<uint8_t> changes;
+};
@@ -0,0 +1,85 @@
+#include "upload_ring.hpp"
+
+#include "gl_extensions.hpp"
+
+UploadRing::UploadRing(size_t region_size, int region_count)
+    : region_size(region_size), fences(region_count, nullptr)
+{
+    size_t buffer_size = region_size * region_count;
+    glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    if (glext::buffer_storage)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glext::bufferStorage(GL_PIXEL_UNPACK_BUFFER, buffer_size, NULL, flags);
+        persistent = static_cast<uint8_t *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, buffer_size, flags));
+    }
+    if (persistent == nullptr)
+    {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, buffer_size, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+UploadRing::~UploadRing()
+{
+    for (GLsync fence : fences)
+    {
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    if (persistent != nullptr || mapped)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &pbo);
+}
+
+uint8_t *UploadRing::map()
+{
+    GLsync &fence = fences[current];
+    if (fence != nullptr)
+    {
+        if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            stall_count++;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (persistent != nullptr)
+    {
+        return persistent + region_size * current;
+    }
+    // the fence already proved that the gpu is done with the region, the driver does not need to synchronize
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    void *region = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, region_size * current, region_size,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    mapped = region != NULL;
+    return static_cast<uint8_t *>(region);
+}
+
+void UploadRing::upload(unsigned int texture, int width, int height, GLenum format, GLenum type)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    if (mapped)
+    {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        mapped = false;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // with a bound unpack buffer, the data pointer is an offset in the buffer
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, reinterpret_cast<const void *>(region_size * current));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    current = (current + 1) % fences.size();
+}
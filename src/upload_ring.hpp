@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h> // needed to handle opengl function pointers
+#include <vector>
+
+/**
+ * Texture uploads written straight into memory the gpu reads from
+ * A pixel unpack buffer is split in regions, one per upload in flight (3 by default: one being written by the cpu,
+ * one being copied by the gpu, one spare). With GL_ARB_buffer_storage the buffer is mapped once for good
+ * (persistent and coherent), so writing a region is a plain memory write and the upload is a copy the gpu does on its
+ * own. A fence per region tells when the gpu is done with it; the cpu only waits if it laps the gpu.
+ * Without the extension every region is mapped unsynchronized before it is written, once its fence is signaled
+ **/
+class UploadRing
+{
+public:
+    UploadRing(size_t region_size, int region_count = 3);
+    ~UploadRing();
+
+    UploadRing(const UploadRing &) = delete;
+    UploadRing &operator=(const UploadRing &) = delete;
+
+    /**
+     * Return the memory of the next upload, region_size bytes, waiting for the gpu to be done with it if needed
+     **/
+    uint8_t *map();
+
+    /**
+     * Copy the region returned by map into the whole level 0 of a 2d texture, without waiting for the copy
+     **/
+    void upload(unsigned int texture, int width, int height, GLenum format, GLenum type);
+
+    bool isPersistent() const { return persistent != nullptr; }
+    // uploads that had to wait for the gpu
+    long stallCount() const { return stall_count; }
+
+private:
+    size_t region_size;
+    unsigned int pbo{0};
+    // whole buffer, when persistently mapped
+    uint8_t *persistent{nullptr};
+    std::vector<GLsync> fences;
+    int current{0};
+    bool mapped{false};
+    long stall_count{0};
+};
@@ -0,0 +1,137 @@
+#include "work_stealing.hpp"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(int threads)
+{
+    if (threads <= 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers = std::vector<Worker>(threads);
+    for (int index = 0; index < threads; ++index)
+    {
+        workers[index].thread = std::thread(&WorkStealingPool::work, this, index);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        run_id++;
+    }
+    run_ready.notify_all();
+    for (Worker &worker : workers)
+    {
+        worker.thread.join();
+    }
+}
+
+void WorkStealingPool::run(const std::vector<std::vector<uint32_t>> &initial, const Task &new_task)
+{
+    long total = 0;
+    for (size_t i = 0; i < initial.size(); ++i)
+    {
+        Worker &worker = workers[i % workers.size()];
+        worker.items.insert(worker.items.end(), initial[i].begin(), initial[i].end());
+        total += long(initial[i].size());
+    }
+    if (total == 0)
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    task = &new_task;
+    pending = total;
+    running = int(workers.size());
+    run_id++;
+    run_ready.notify_all();
+    run_done.wait(lock, [this]()
+                  { return running == 0; });
+}
+
+bool WorkStealingPool::takeOwn(Worker &worker, uint32_t &item)
+{
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.items.empty())
+    {
+        return false;
+    }
+    // newest first, the tasks pushed last are the most likely to be in the cache
+    item = worker.items.back();
+    worker.items.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(int thief, uint32_t &item)
+{
+    int count = int(workers.size());
+    // victims in a different order for every thief, so they do not all fall on the same one
+    for (int offset = 1; offset < count; ++offset)
+    {
+        Worker &victim = workers[(thief + offset) % count];
+        std::vector<uint32_t> taken;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            // oldest half, the owner keeps working on the back
+            size_t half = (victim.items.size() + 1) / 2;
+            if (half == 0)
+            {
+                continue;
+            }
+            taken.assign(victim.items.begin(), victim.items.begin() + half);
+            victim.items.erase(victim.items.begin(), victim.items.begin() + half);
+        }
+        steals++;
+        stolen += long(taken.size());
+        item = taken.front();
+        Worker &own = workers[thief];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.items.insert(own.items.end(), taken.begin() + 1, taken.end());
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::work(int index)
+{
+    Worker &worker = workers[index];
+    long last_run = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            run_ready.wait(lock, [&]()
+                           { return run_id != last_run; });
+            last_run = run_id;
+            if (quit)
+            {
+                return;
+            }
+        }
+
+        // tasks can only be stolen while some are pending, nobody adds new ones
+        while (pending.load(std::memory_order_acquire) > 0)
+        {
+            uint32_t item;
+            if (takeOwn(worker, item) || steal(index, item))
+            {
+                (*task)(item);
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running == 0)
+        {
+            run_done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Pool of worker threads running many small tasks, each worker with its own deque of tasks
+ * A worker takes its own tasks from the back of its deque, and once it is empty steals half of the tasks at the
+ * front of the deque of another worker. Tasks placed badly (all of them in a few deques) still end up spread
+ * across every worker, without any central queue every task would go through
+ **/
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void(uint32_t item)>;
+
+    // threads = 0 for one worker per cpu
+    explicit WorkStealingPool(int threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    int threadCount() const { return int(workers.size()); }
+
+    /**
+     * Run task on every item, items of initial[i] starting in the deque of worker i % threadCount()
+     * Return once every task is done
+     **/
+    void run(const std::vector<std::vector<uint32_t>> &initial, const Task &task);
+
+    // totals since the pool was created
+    long stealCount() const { return steals.load(); }
+    long stolenCount() const { return stolen.load(); }
+
+private:
+    // one cache line each, owners and thieves of different deques do not share lines
+    struct alignas(64) Worker
+    {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<uint32_t> items;
+    };
+
+    void work(int index);
+    bool takeOwn(Worker &worker, uint32_t &item);
+    bool steal(int thief, uint32_t &item);
+
+    std::vector<Worker> workers;
+
+    std::mutex mutex;
+    std::condition_variable run_ready, run_done;
+    long run_id{0};
+    int running{0};
+    bool quit{false};
+    const Task *task{nullptr};
+    std::atomic<long> pending{0};
+
+    std::atomic<long> steals{0};
+    std::atomic<long> stolen{0};
+};